@@ -7,24 +7,222 @@
 #include <SDL2/SDL_mixer.h>
 #include <stdexcept>
 #include <random>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <optional>
+#include <unordered_map>
+#include <thread>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include <string_view>
 
-void initialize_sdl();
+#include "aabb-tree.hpp"
+#include "alloc-tracker.hpp"
+#include "audio-queue.hpp"
+#include "benchmarks.hpp"
+#include "bounce-kernel.hpp"
+#include "camera.hpp"
+#include "entity-store.hpp"
+#include "frame-capture.hpp"
+#include "golden-image.hpp"
+#include "input-recording.hpp"
+#include "job-system.hpp"
+#include "layer-cache.hpp"
+#include "object-pool.hpp"
+#include "offline-audio.hpp"
+#include "particles.hpp"
+#include "pcm-cache.hpp"
+#include "profiler.hpp"
+#include "render-commands.hpp"
+#include "render-probe.hpp"
+#include "soft-blitter.hpp"
+#include "sound-events.hpp"
+#include "spatial-hash.hpp"
+#include "streaming-texture.hpp"
+#include "text-cache.hpp"
+#include "tilemap.hpp"
+#include "triple-buffer.hpp"
+
+void initialize_sdl(Uint32 sdl_flags = SDL_INIT_EVERYTHING);
 void close_sdl();
+void render_audio(const std::string &path);
+bool run_golden(const std::filesystem::path &directory, bool update, int tolerance);
+
+// Every C++ allocation in the program goes through AllocTracker, including the standard library's.
+void *operator new(std::size_t size)
+{
+    if (void *block = AllocTracker::allocate(AllocSource::New, size))
+    {
+        return block;
+    }
+    throw std::bad_alloc{};
+}
+
+void *operator new(std::size_t size, std::align_val_t align)
+{
+    if (void *block = AllocTracker::allocate(AllocSource::New, size, static_cast<std::size_t>(align)))
+    {
+        return block;
+    }
+    throw std::bad_alloc{};
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return AllocTracker::allocate(AllocSource::New, size);
+}
+
+void *operator new(std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    return AllocTracker::allocate(AllocSource::New, size, static_cast<std::size_t>(align));
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+void *operator new[](std::size_t size, std::align_val_t align) { return operator new(size, align); }
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept { return operator new(size, tag); }
+void *operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t &tag) noexcept
+{
+    return operator new(size, align, tag);
+}
+
+void operator delete(void *block) noexcept { AllocTracker::release(AllocSource::New, block); }
+void operator delete(void *block, std::size_t) noexcept { AllocTracker::release(AllocSource::New, block); }
+void operator delete(void *block, const std::nothrow_t &) noexcept { AllocTracker::release(AllocSource::New, block); }
+void operator delete[](void *block) noexcept { AllocTracker::release(AllocSource::New, block); }
+void operator delete[](void *block, std::size_t) noexcept { AllocTracker::release(AllocSource::New, block); }
+void operator delete[](void *block, const std::nothrow_t &) noexcept
+{
+    AllocTracker::release(AllocSource::New, block);
+}
+
+void operator delete(void *block, std::align_val_t align) noexcept
+{
+    AllocTracker::release(AllocSource::New, block, static_cast<std::size_t>(align));
+}
+
+void operator delete(void *block, std::size_t, std::align_val_t align) noexcept
+{
+    AllocTracker::release(AllocSource::New, block, static_cast<std::size_t>(align));
+}
+
+void operator delete(void *block, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    AllocTracker::release(AllocSource::New, block, static_cast<std::size_t>(align));
+}
+
+void operator delete[](void *block, std::align_val_t align) noexcept
+{
+    AllocTracker::release(AllocSource::New, block, static_cast<std::size_t>(align));
+}
+
+void operator delete[](void *block, std::size_t, std::align_val_t align) noexcept
+{
+    AllocTracker::release(AllocSource::New, block, static_cast<std::size_t>(align));
+}
+
+void operator delete[](void *block, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    AllocTracker::release(AllocSource::New, block, static_cast<std::size_t>(align));
+}
+
+struct Bullet
+{
+    float x;
+    float y;
+    float xvel;
+    float yvel;
+};
+
+// Everything the render thread draws for one simulation tick.
+struct FrameSnapshot
+{
+    Uint64 tick;
+    SDL_Color clear_color;
+    SDL_Rect sprite_rect;
+    Camera camera;
+    std::vector<SDL_FRect> texts;
+    std::vector<SDL_Texture *> text_textures;
+    std::vector<SDL_FRect> bullets;
+    ParticleSnapshot particles;
+};
+
+enum DrawLayer : Uint8
+{
+    LayerTexts = 1,
+    LayerSprite,
+    LayerBullets,
+    LayerHud,
+};
+
+enum InputBit
+{
+    InputLeft,
+    InputRight,
+    InputUp,
+    InputDown,
+    InputFire,
+    InputColor,
+    InputSpawn,
+    InputChime,
+    InputFountain,
+    InputQuit,
+    InputZoomIn,
+    InputZoomOut,
+};
 
 class Game
 {
 public:
     Game();
+    void record_to(const std::string &path);
+    void capture_to(const std::string &path);
+    void use_tilemap(const std::string &path);
+    void replay_from(const std::string &path);
+    void replay_inputs(InputRecording recording, std::string_view source);
+    void reprobe_renderer();
+    void run_headless();
     void init();
     void run();
+    std::vector<SurfacePtr> render_ticks(const std::vector<Uint64> &ticks);
     void load_media();
+    void report() const;
 
     static constexpr int width{800};
     static constexpr int height{600};
+    static constexpr int tick_rate{60};
+    static constexpr int hud_font_size{18};
+    // Rendered frames before the loop is expected to stop allocating.
+    static constexpr int steady_state_after{120};
 
 private:
+    bool poll_events();
+    void simulate();
+    InputFrame next_input();
+    bool tick(const InputFrame &input);
+    void publish();
+    void render(const FrameSnapshot &snapshot);
+    void draw_frame(const FrameSnapshot &snapshot);
+    Uint32 state_checksum() const;
     void update_text();
-    void update_sprite();
+    void spawn_text(int count);
+    void update_sprite(const InputFrame &input);
+    void update_bullets(const InputFrame &input);
+    void update_camera(const InputFrame &input);
+    void render_bullets(const FrameSnapshot &snapshot);
+    void render_particles(const FrameSnapshot &snapshot);
+    void render_background(const Camera &camera);
+    void use_soft_compositor();
+    void render_software(const FrameSnapshot &snapshot);
+    void render_minimap(const FrameSnapshot &snapshot);
+    void render_hud(const FrameSnapshot &snapshot);
+    void update_collisions();
+    void update_view_tree();
+    void collect_visible(FrameSnapshot &snapshot);
+    void render_visible(const FrameSnapshot &snapshot);
 
     const std::string title;
     SDL_Event event;
@@ -33,14 +231,45 @@ private:
     int font_size;
     SDL_Color font_color;
     std::string text_str;
-    SDL_Rect text_rect;
     const int text_vel;
-    int text_xvel;
-    int text_yvel;
+    EntityStore entities;
+    EntityHandle text_entity;
+    JobSystem jobs;
+    SpatialHash broad_phase;
+    std::vector<Uint32> sprite_hits;
+    AabbTree view_tree;
+    std::vector<int> proxies;
+    std::vector<Uint32> visible;
+    Profiler sim_profiler;
+    Profiler render_profiler;
+    RenderCommandBuffer draw_commands;
+    TripleBuffer<FrameSnapshot> snapshots;
+    std::thread sim_thread;
+    std::atomic<bool> sim_running;
+    std::exception_ptr sim_error;
+    double run_seconds;
     SDL_Rect sprite_rect;
     const int sprite_vel;
+    Camera camera;
+    ObjectPool<Bullet> bullets;
+    ParticleSystem particles;
+    ParticleGeometry particle_geometry;
+    int spark_emitter;
+    int fountain_emitter;
 
     const Uint8 *keystate;
+    std::atomic<Uint16> held_keys;
+    std::atomic<Uint16> pressed_keys;
+    SDL_Color clear_color;
+    std::string record_path;
+    InputRecording recording;
+    std::optional<InputRecording> replay;
+    std::size_t replay_tick;
+    std::optional<Uint64> replay_divergence;
+    RenderProbe render_probe;
+    bool force_probe;
+    bool headless;
+    std::string capture_path;
 
     std::unique_ptr<SDL_Window, decltype(&SDL_DestroyWindow)> window;
     std::unique_ptr<SDL_Renderer, decltype(&SDL_DestroyRenderer)> renderer;
@@ -50,18 +279,77 @@ private:
     std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)> text;
     std::unique_ptr<SDL_Surface, decltype(&SDL_FreeSurface)> icon_surface;
     std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)> sprite;
+    std::string tilemap_path;
+    std::optional<Tilemap> tilemap;
+    std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)> tileset;
+    std::optional<TilemapRenderer> tilemap_renderer;
+    bool show_tilemap;
+    LayerCache static_layers;
+    int decoration_layer;
+    SoftCompositor compositor;
+    std::unordered_map<SDL_Texture *, SurfacePtr> soft_sprites;
+    SurfacePtr soft_background;
+    std::optional<StreamingTexture> soft_frame;
+    std::optional<StreamingTexture> minimap;
+    std::optional<FrameCapture> capture;
+    std::unique_ptr<TTF_Font, decltype(&TTF_CloseFont)> hud_font;
+    std::optional<TextCache> text_cache;
+    bool show_hud;
+    SDL_Rect minimap_drawn;
+    bool show_minimap;
+    PcmCache pcm_cache;
+    std::unique_ptr<Mix_Music, decltype(&Mix_FreeMusic)> music;
+    PcmCache::Chunk c_sound;
+    PcmCache::Chunk sdl_sound;
+    AudioCommandQueue audio_queue;
+    SoundEventCoalescer sound_events;
+    int bounce_sound;
+    int sdl_sound_event;
+    int c_sound_event;
+    Uint64 frame;
 };
 
 Game::Game() : title{"Sound Effects and Music"}, gen{}, rand_color{0, 255}, font_size{80},
                font_color{255, 255, 255, 255},
                text_str{"SDL"},
-               text_rect{0, 0, 0, 0},
                text_vel{1},
-               text_xvel{1},
-               text_yvel{1},
+               entities{},
+               text_entity{0, 0},
+               jobs{},
+               broad_phase{64.0f},
+               sprite_hits{},
+               view_tree{},
+               proxies{},
+               visible{},
+               sim_profiler{},
+               render_profiler{},
+               draw_commands{},
+               snapshots{},
+               sim_thread{},
+               sim_running{false},
+               sim_error{},
+               run_seconds{0.0},
                sprite_rect{0, 0, 0, 0},
                sprite_vel{5},
+               camera{{0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height)}},
+               bullets{1024, ObjectPool<Bullet>::Growth::Growable},
+               particles{},
+               particle_geometry{},
+               spark_emitter{-1},
+               fountain_emitter{-1},
                keystate{SDL_GetKeyboardState(nullptr)},
+               held_keys{0},
+               pressed_keys{0},
+               clear_color{0, 0, 0, 255},
+               record_path{},
+               recording{},
+               replay{},
+               replay_tick{0},
+               replay_divergence{},
+               render_probe{"cache/render-driver.txt"},
+               force_probe{false},
+               headless{false},
+               capture_path{},
                window(nullptr, SDL_DestroyWindow),
                renderer(nullptr, SDL_DestroyRenderer),
                backgroud(nullptr, SDL_DestroyTexture),
@@ -69,23 +357,63 @@ Game::Game() : title{"Sound Effects and Music"}, gen{}, rand_color{0, 255}, font
                text_surface{nullptr, SDL_FreeSurface},
                text{nullptr, SDL_DestroyTexture},
                icon_surface{nullptr, SDL_FreeSurface},
-               sprite{nullptr, SDL_DestroyTexture} {}
+               sprite{nullptr, SDL_DestroyTexture},
+               tilemap_path{},
+               tilemap{},
+               tileset{nullptr, SDL_DestroyTexture},
+               tilemap_renderer{},
+               show_tilemap{false},
+               static_layers{width, height},
+               decoration_layer{-1},
+               compositor{jobs},
+               soft_sprites{},
+               soft_background{nullptr, SDL_FreeSurface},
+               soft_frame{},
+               minimap{},
+               capture{},
+               hud_font{nullptr, TTF_CloseFont},
+               text_cache{},
+               show_hud{true},
+               minimap_drawn{0, 0, 0, 0},
+               show_minimap{false},
+               pcm_cache{"cache/pcm"},
+               music{nullptr, Mix_FreeMusic},
+               c_sound{nullptr, Mix_FreeChunk},
+               sdl_sound{nullptr, Mix_FreeChunk},
+               sound_events{},
+               bounce_sound{-1},
+               sdl_sound_event{-1},
+               c_sound_event{-1},
+               frame{0}
+{
+    // Centred on the arena the texts bounce in, so the first frame matches the fixed background layers.
+    this->camera.look_at(width / 2.0, height / 2.0);
+}
 
 void Game::init()
 {
-    this->window.reset(SDL_CreateWindow(this->title.c_str(), SDL_WINDOWPOS_CENTERED,
-                                        SDL_WINDOWPOS_CENTERED, this->width, this->height, 0));
+    AllocTracker::Scope alloc_scope{AllocSite::Init};
+    this->window.reset(SDL_CreateWindow(this->title.c_str(), SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                                        this->width, this->height, this->headless ? SDL_WINDOW_HIDDEN : 0));
     if (!this->window.get())
     {
         auto error = std::format("Failed to create window: {}", SDL_GetError());
         throw std::runtime_error(error);
     }
 
-    this->renderer.reset(SDL_CreateRenderer(this->window.get(), -1, SDL_RENDERER_ACCELERATED));
-    if (!this->renderer.get())
+    // Headless runs must draw the same pixels on every machine, so they skip the probe.
+    if (this->headless)
     {
-        auto error = std::format("Failed to create renderer: {}", SDL_GetError());
-        throw std::runtime_error(error);
+        this->renderer.reset(SDL_CreateRenderer(this->window.get(), -1, SDL_RENDERER_SOFTWARE));
+        if (!this->renderer)
+        {
+            auto error = std::format("Failed to create renderer: {}", SDL_GetError());
+            throw std::runtime_error(error);
+        }
+    }
+    else
+    {
+        this->renderer.reset(this->render_probe.create(this->window.get(), this->force_probe));
     }
 
     this->icon_surface.reset(IMG_Load("images/C-logo.png"));
@@ -97,11 +425,65 @@ void Game::init()
 
     SDL_SetWindowIcon(this->window.get(), this->icon_surface.get());
 
-    this->gen.seed(std::random_device()());
+    // The seed is part of a recording, so replays draw the same numbers.
+    this->recording.seed = this->replay ? this->replay->seed : std::random_device()();
+    this->recording.tick_rate = this->tick_rate;
+    this->gen.seed(static_cast<std::mt19937::result_type>(this->recording.seed));
+}
+
+void Game::record_to(const std::string &path)
+{
+    this->record_path = path;
+}
+
+// A path ending in .y4m records one video stream; anything else is a directory of PNGs.
+void Game::capture_to(const std::string &path)
+{
+    this->capture_path = path;
+}
+
+void Game::use_tilemap(const std::string &path)
+{
+    this->tilemap_path = path;
+    this->show_tilemap = true;
+}
+
+// Ignores the cached render driver and benchmarks them all again.
+void Game::reprobe_renderer()
+{
+    this->force_probe = true;
+}
+
+// A hidden window and the software renderer, for render_ticks() under the dummy video driver.
+void Game::run_headless()
+{
+    this->headless = true;
+}
+
+void Game::replay_from(const std::string &path)
+{
+    this->replay_inputs(InputRecording::load(path), path);
+}
+
+void Game::replay_inputs(InputRecording recording, std::string_view source)
+{
+    if (recording.ticks.empty())
+    {
+        auto error = std::format("Error replaying {}: no ticks recorded", source);
+        throw std::runtime_error(error);
+    }
+    if (recording.tick_rate != this->tick_rate)
+    {
+        auto error = std::format("Error replaying {}: recorded at {} ticks/s, game runs at {}", source,
+                                 recording.tick_rate, this->tick_rate);
+        throw std::runtime_error(error);
+    }
+    this->replay = std::move(recording);
 }
 
 void Game::load_media()
 {
+    AllocTracker::Scope alloc_scope{AllocSite::LoadMedia};
     this->backgroud.reset(IMG_LoadTexture(this->renderer.get(), "images/background.png"));
     if (!this->backgroud)
     {
@@ -116,6 +498,15 @@ void Game::load_media()
         throw std::runtime_error(error);
     }
 
+    this->hud_font.reset(TTF_OpenFont("fonts/freesansbold.ttf", hud_font_size));
+    if (!this->hud_font)
+    {
+        auto error = std::format("Error creating Font: {}", TTF_GetError());
+        throw std::runtime_error(error);
+    }
+    this->text_cache.emplace(this->renderer.get(), 1 << 20,
+                             [this](SDL_Texture *texture) { this->draw_commands.forget(texture); });
+
     this->text_surface.reset(TTF_RenderText_Blended(this->font.get(), this->text_str.c_str(), this->font_color));
     if (!this->text_surface)
     {
@@ -123,9 +514,6 @@ void Game::load_media()
         throw std::runtime_error(error);
     }
 
-    this->text_rect.w = this->text_surface->w;
-    this->text_rect.h = this->text_surface->h;
-
     this->text.reset(SDL_CreateTextureFromSurface(this->renderer.get(), this->text_surface.get()));
     if (!this->text)
     {
@@ -133,6 +521,9 @@ void Game::load_media()
         throw std::runtime_error(error);
     }
 
+    this->text_entity = this->entities.spawn(0, 0, this->text_vel, this->text_vel, this->text_surface->w,
+                                             this->text_surface->h, this->text.get());
+
     this->sprite.reset(SDL_CreateTextureFromSurface(this->renderer.get(), this->icon_surface.get()));
     if (!this->sprite)
     {
@@ -145,97 +536,997 @@ void Game::load_media()
         auto error = std::format("Error querying Texture: {}", SDL_GetError());
         throw std::runtime_error(error);
     }
+
+    // The background and decoration never move, so they are composited once into one texture.
+    this->static_layers.add_static(
+        [this](SDL_Renderer *renderer) { SDL_RenderCopy(renderer, this->backgroud.get(), nullptr, nullptr); });
+    this->decoration_layer = this->static_layers.add_static(
+        [this](SDL_Renderer *renderer)
+        {
+            SDL_Rect logo{this->width - this->sprite_rect.w / 2 - 16, this->height - this->sprite_rect.h / 2 - 16,
+                          this->sprite_rect.w / 2, this->sprite_rect.h / 2};
+            SDL_SetTextureAlphaMod(this->sprite.get(), 96);
+            SDL_RenderCopy(renderer, this->sprite.get(), nullptr, &logo);
+            SDL_SetTextureAlphaMod(this->sprite.get(), 255);
+
+            SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 128);
+            SDL_Rect edges[] = {{0, 0, this->width, 6},
+                                {0, this->height - 6, this->width, 6},
+                                {0, 6, 6, this->height - 12},
+                                {this->width - 6, 6, 6, this->height - 12}};
+            SDL_RenderFillRects(renderer, edges, 4);
+        });
+
+    SDL_RendererInfo info;
+    if (!SDL_GetRendererInfo(this->renderer.get(), &info) && (info.flags & SDL_RENDERER_SOFTWARE))
+    {
+        this->use_soft_compositor();
+    }
+
+    this->c_sound = this->pcm_cache.load("sounds/C.ogg");
+    this->sdl_sound = this->pcm_cache.load("sounds/SDL.ogg");
+
+    this->bounce_sound = this->sound_events.add_sound(this->sdl_sound.get(), 6, 0.5f);
+    this->sdl_sound_event = this->sound_events.add_sound(this->sdl_sound.get(), 0);
+    this->c_sound_event = this->sound_events.add_sound(this->c_sound.get(), 0);
+
+    // Seeded from gen so recordings replay the same particles.
+    this->particles = ParticleSystem{static_cast<Uint32>(this->gen()), 300.0f};
+    this->spark_emitter = this->particles.add_emitter({0.0f, 0.5f, 1.2f, 100.0f, 350.0f, 0.0f, 3.1416f,
+                                                       {{0.0f, {255, 255, 255, 255}},
+                                                        {0.3f, {255, 220, 64, 255}},
+                                                        {1.0f, {255, 64, 0, 0}}},
+                                                       {{0.0f, 4.0f}, {1.0f, 1.0f}}});
+    this->fountain_emitter = this->particles.add_emitter({80'000.0f, 2.0f, 3.0f, 200.0f, 400.0f, -1.5708f, 0.4f,
+                                                          {{0.0f, {160, 220, 255, 255}}, {1.0f, {0, 64, 255, 0}}},
+                                                          {{0.0f, 3.0f}, {1.0f, 1.0f}}});
+    this->particles.move_emitter(this->fountain_emitter, this->width / 2.0f, static_cast<float>(this->height));
+    this->particles.reserve(250'000);
+
+    this->music.reset(Mix_LoadMUS("music/freesoftwaresong-8bit.ogg"));
+    if (!this->music)
+    {
+        auto error = std::format("Error loading Music: {}", Mix_GetError());
+        throw std::runtime_error(error);
+    }
 }
 
 void Game::update_text()
 {
-    this->text_rect.x += this->text_xvel;
-    this->text_rect.y += this->text_yvel;
+    std::atomic<std::size_t> bounces{0};
+    BounceKernel kernel = best_bounce_kernel();
+    this->jobs.parallel_for(0, this->entities.size(), 16384,
+                            [&](std::size_t begin, std::size_t end)
+                            {
+                                std::size_t n = bounce_entities(this->entities, begin, end, this->width,
+                                                                this->height, kernel);
+                                bounces.fetch_add(n, std::memory_order_relaxed);
+                            });
 
-    if (this->text_rect.x < 0)
+    if (bounces)
     {
-        this->text_xvel = this->text_vel;
+        this->sound_events.trigger(this->bounce_sound, 0.5f, static_cast<int>(bounces));
     }
-    else if (this->text_rect.x + this->text_rect.w > this->width)
+}
+
+void Game::spawn_text(int count)
+{
+    std::uniform_real_distribution<float> x_pos{0.0f, static_cast<float>(this->width - this->text_surface->w)};
+    std::uniform_real_distribution<float> y_pos{0.0f, static_cast<float>(this->height - this->text_surface->h)};
+    std::bernoulli_distribution flip{};
+
+    for (int i = 0; i < count; ++i)
+    {
+        float xvel = flip(this->gen) ? this->text_vel : -this->text_vel;
+        float yvel = flip(this->gen) ? this->text_vel : -this->text_vel;
+        this->entities.spawn(x_pos(this->gen), y_pos(this->gen), xvel, yvel, this->text_surface->w,
+                             this->text_surface->h, this->text.get());
+    }
+}
+
+// Hold F to fire from the sprite; bullets die when they leave the camera's view.
+void Game::update_bullets(const InputFrame &input)
+{
+    const Aabb view = this->camera.view();
+    this->bullets.for_each(
+        [&](PoolHandle handle, Bullet &bullet)
+        {
+            bullet.x += bullet.xvel;
+            bullet.y += bullet.yvel;
+            if (bullet.x < view.left - 8.0f || bullet.x > view.right || bullet.y < view.top - 8.0f ||
+                bullet.y > view.bottom)
+            {
+                this->bullets.destroy(handle);
+            }
+        });
+
+    if (input.is_held(InputFire))
+    {
+        std::uniform_real_distribution<float> spread{-2.0f, 2.0f};
+        float x = this->sprite_rect.x + this->sprite_rect.w / 2.0f;
+        float y = static_cast<float>(this->sprite_rect.y);
+        for (int i = 0; i < 8; ++i)
+        {
+            this->bullets.create(Bullet{x, y, spread(this->gen), -8.0f + spread(this->gen)});
+        }
+    }
+    this->sim_profiler.add("bullets live", static_cast<double>(this->bullets.size()));
+}
+
+void Game::render_bullets(const FrameSnapshot &snapshot)
+{
+    for (const SDL_FRect &bullet : snapshot.bullets)
     {
-        this->text_xvel = -this->text_vel;
+        this->draw_commands.fill(LayerBullets, 0, bullet, {255, 220, 64, 255});
     }
+}
+
+// Vertices are built in parallel, then every particle goes out in one SDL_RenderGeometry call.
+void Game::render_particles(const FrameSnapshot &snapshot)
+{
+    const ParticleSnapshot &particles = snapshot.particles;
+    this->particle_geometry.set_camera(&snapshot.camera);
+    this->particle_geometry.resize(particles.size());
+    this->jobs.parallel_for(0, particles.size(), 16384,
+                            [&](std::size_t begin, std::size_t end)
+                            { this->particle_geometry.build(particles, begin, end); });
+    // Untextured geometry blends with the draw blend mode; the curves fade alpha out.
+    SDL_SetRenderDrawBlendMode(this->renderer.get(), SDL_BLENDMODE_BLEND);
+    this->particle_geometry.render(this->renderer.get());
+}
 
-    if (this->text_rect.y < 0)
+/*
+Hold + or - to zoom. The camera stays put while the sprite is in the middle
+80% of the view and eases after it once it strays further, so the sprite can
+roam the whole world.
+*/
+void Game::update_camera(const InputFrame &input)
+{
+    if (input.is_held(InputZoomIn))
     {
-        this->text_yvel = this->text_vel;
+        this->camera.zoom_by(1.02f);
     }
-    else if (this->text_rect.y + this->text_rect.h > this->height)
+    if (input.is_held(InputZoomOut))
     {
-        this->text_yvel = -this->text_vel;
+        this->camera.zoom_by(1.0f / 1.02f);
     }
+
+    const Aabb view = this->camera.view();
+    auto target = [](double centre, double sprite, double half)
+    {
+        double slack = half * 0.8;
+        double offset = sprite - centre;
+        return std::abs(offset) <= slack ? centre : sprite - std::copysign(slack, offset);
+    };
+    double sprite_x = this->sprite_rect.x + this->sprite_rect.w / 2.0;
+    double sprite_y = this->sprite_rect.y + this->sprite_rect.h / 2.0;
+    this->camera.follow(target(this->camera.centre_x(), sprite_x, (view.right - view.left) / 2.0),
+                        target(this->camera.centre_y(), sprite_y, (view.bottom - view.top) / 2.0), 0.2);
 }
 
-void Game::update_sprite()
+void Game::update_sprite(const InputFrame &input)
 {
-    if (this->keystate[SDL_SCANCODE_LEFT] || this->keystate[SDL_SCANCODE_A])
+    if (input.is_held(InputLeft))
     {
         this->sprite_rect.x -= this->sprite_vel;
     }
-    if (this->keystate[SDL_SCANCODE_RIGHT] || this->keystate[SDL_SCANCODE_D])
+    if (input.is_held(InputRight))
     {
         this->sprite_rect.x += this->sprite_vel;
     }
-    if (this->keystate[SDL_SCANCODE_UP] || this->keystate[SDL_SCANCODE_W])
+    if (input.is_held(InputUp))
     {
         this->sprite_rect.y -= this->sprite_vel;
     }
-    if (this->keystate[SDL_SCANCODE_DOWN] || this->keystate[SDL_SCANCODE_S])
+    if (input.is_held(InputDown))
     {
         this->sprite_rect.y += this->sprite_vel;
     }
 }
 
-void Game::run()
+// Texts bounce off each other and off the player sprite.
+void Game::update_collisions()
+{
+    this->broad_phase.build(this->entities);
+    this->sim_profiler.add("broad phase ms", this->broad_phase.stats().build_ms);
+
+    const float *x = this->entities.x();
+    const float *y = this->entities.y();
+    const float *w = this->entities.w();
+    const float *h = this->entities.h();
+    float *xvel = this->entities.xvel();
+    float *yvel = this->entities.yvel();
+
+    // Equal masses: swap the velocity components that bring the pair closer.
+    std::size_t pairs = this->broad_phase.for_each_pair(
+        [&](Uint32 a, Uint32 b)
+        {
+            if ((x[b] - x[a]) * (xvel[a] - xvel[b]) > 0.0f)
+            {
+                std::swap(xvel[a], xvel[b]);
+            }
+            if ((y[b] - y[a]) * (yvel[a] - yvel[b]) > 0.0f)
+            {
+                std::swap(yvel[a], yvel[b]);
+            }
+        });
+    this->sim_profiler.add("collision pairs", static_cast<double>(pairs));
+
+    // The sprite is immovable: overlapping texts head away from its centre.
+    const SDL_Rect &sprite = this->sprite_rect;
+    this->sprite_hits.clear();
+    this->broad_phase.query_aabb(sprite.x, sprite.y, sprite.w, sprite.h, this->sprite_hits);
+    for (Uint32 i : this->sprite_hits)
+    {
+        float dx = (x[i] + w[i] / 2) - (sprite.x + sprite.w / 2.0f);
+        float dy = (y[i] + h[i] / 2) - (sprite.y + sprite.h / 2.0f);
+        xvel[i] = std::copysign(xvel[i], dx);
+        yvel[i] = std::copysign(yvel[i], dy);
+    }
+}
+
+// Entities only ever spawn, so dense index i keeps proxy i for the whole run.
+void Game::update_view_tree()
+{
+    std::size_t reinserts = 0;
+    for (std::size_t i = 0; i < this->entities.size(); ++i)
+    {
+        Aabb box = Aabb::from_rect(this->entities.rect(i));
+        if (i == this->proxies.size())
+        {
+            this->proxies.push_back(this->view_tree.create(box, static_cast<Uint32>(i)));
+            continue;
+        }
+        reinserts += this->view_tree.move(this->proxies[i], box, this->entities.xvel()[i], this->entities.yvel()[i]);
+    }
+    this->sim_profiler.add("view tree reinserts", static_cast<double>(reinserts));
+}
+
+// Only entities the camera can see make it into the snapshot, in spawn order.
+void Game::collect_visible(FrameSnapshot &snapshot)
+{
+    const Aabb viewport = this->camera.view();
+    this->visible.clear();
+    this->view_tree.query(viewport,
+                          [&](Uint32 i)
+                          {
+                              if (Aabb::from_rect(this->entities.rect(i)).overlaps(viewport))
+                              {
+                                  this->visible.push_back(i);
+                              }
+                          });
+    std::sort(this->visible.begin(), this->visible.end());
+
+    snapshot.texts.clear();
+    snapshot.text_textures.clear();
+    for (Uint32 i : this->visible)
+    {
+        snapshot.texts.push_back(this->entities.rect(i));
+        snapshot.text_textures.push_back(this->entities.texture()[i]);
+    }
+
+    this->sim_profiler.add("visible", static_cast<double>(this->visible.size()));
+    this->sim_profiler.add("culled", static_cast<double>(this->entities.size() - this->visible.size()));
+}
+
+void Game::render_visible(const FrameSnapshot &snapshot)
+{
+    for (std::size_t i = 0; i < snapshot.texts.size(); ++i)
+    {
+        this->draw_commands.copy(LayerTexts, 0, snapshot.text_textures[i], nullptr, snapshot.texts[i]);
+    }
+
+    const SDL_Rect &sprite = snapshot.sprite_rect;
+    SDL_FRect rect{static_cast<float>(sprite.x), static_cast<float>(sprite.y), static_cast<float>(sprite.w),
+                   static_cast<float>(sprite.h)};
+    if (Aabb::from_rect(rect).overlaps(snapshot.camera.view()))
+    {
+        this->draw_commands.copy(LayerSprite, 0, this->sprite.get(), nullptr, rect);
+    }
+}
+
+// Returns false once the window is closed.
+bool Game::poll_events()
 {
-    while (true)
+    while (SDL_PollEvent(&this->event))
     {
-        while (SDL_PollEvent(&this->event))
+        switch (event.type)
         {
-            switch (event.type)
+        case SDL_QUIT:
+            return false;
+        case SDL_RENDER_TARGETS_RESET:
+        case SDL_RENDER_DEVICE_RESET:
+            if (this->tilemap_renderer)
             {
-            case SDL_QUIT:
-                return;
-                break;
-            case SDL_KEYDOWN:
-                switch (event.key.keysym.scancode)
+                this->tilemap_renderer->invalidate_all();
+            }
+            this->static_layers.invalidate();
+            for (auto *streaming : {&this->soft_frame, &this->minimap})
+            {
+                if (*streaming)
                 {
-                case SDL_SCANCODE_ESCAPE:
-                    return;
-                    break;
-                case SDL_SCANCODE_SPACE:
-                    SDL_SetRenderDrawColor(
-                        this->renderer.get(), this->rand_color(gen),
-                        this->rand_color(gen), this->rand_color(gen), 255);
-                    break;
-                default:
-                    break;
+                    (*streaming)->invalidate();
                 }
+            }
+            break;
+        case SDL_KEYDOWN:
+            switch (event.key.keysym.scancode)
+            {
+            case SDL_SCANCODE_ESCAPE:
+                this->pressed_keys.fetch_or(1u << InputQuit);
+                break;
+            case SDL_SCANCODE_SPACE:
+                this->pressed_keys.fetch_or(1u << InputColor);
+                break;
+            case SDL_SCANCODE_B:
+                this->pressed_keys.fetch_or(1u << InputSpawn);
+                break;
+            case SDL_SCANCODE_C:
+                this->pressed_keys.fetch_or(1u << InputChime);
+                break;
+            case SDL_SCANCODE_P:
+                this->pressed_keys.fetch_or(1u << InputFountain);
+                break;
+            // Only changes what is drawn, so it stays out of the recorded input.
+            case SDL_SCANCODE_M:
+                this->show_tilemap = !this->show_tilemap;
+                break;
+            case SDL_SCANCODE_V:
+                this->static_layers.set_enabled(this->decoration_layer,
+                                                !this->static_layers.enabled(this->decoration_layer));
+                break;
+            case SDL_SCANCODE_N:
+                this->show_minimap = !this->show_minimap;
+                break;
+            case SDL_SCANCODE_H:
+                this->show_hud = !this->show_hud;
+                break;
             default:
                 break;
             }
+        default:
+            break;
         }
+    }
+    return true;
+}
+
+// Keys sampled by the main thread, or the next recorded tick when replaying.
+InputFrame Game::next_input()
+{
+    if (this->replay)
+    {
+        return this->replay->ticks[this->replay_tick].input;
+    }
+
+    return {this->held_keys.load(std::memory_order_relaxed), this->pressed_keys.exchange(0)};
+}
+
+// One fixed step of the simulation. Everything it reads comes from `input` and `gen`.
+bool Game::tick(const InputFrame &input)
+{
+    Profiler::Scope scope{this->sim_profiler, "update ms"};
 
-        this->update_text();
-        this->update_sprite();
+    if (input.was_pressed(InputColor))
+    {
+        this->clear_color = {this->rand_color(gen), this->rand_color(gen), this->rand_color(gen), 255};
+        this->sound_events.trigger(this->sdl_sound_event);
+        this->particles.move_emitter(this->spark_emitter, this->sprite_rect.x + this->sprite_rect.w / 2.0f,
+                                     this->sprite_rect.y + this->sprite_rect.h / 2.0f);
+        this->particles.burst(this->spark_emitter, 2000);
+    }
+    if (input.was_pressed(InputFountain))
+    {
+        this->particles.set_active(this->fountain_emitter, !this->particles.active(this->fountain_emitter));
+    }
+    if (input.was_pressed(InputSpawn))
+    {
+        this->spawn_text(100);
+    }
+    if (input.was_pressed(InputChime))
+    {
+        this->sound_events.trigger(this->c_sound_event);
+    }
 
-        SDL_RenderClear(this->renderer.get());
+    this->update_text();
+    this->update_sprite(input);
+    this->update_camera(input);
+    this->update_bullets(input);
+    this->particles.update(1.0f / this->tick_rate);
+    this->update_collisions();
+    this->update_view_tree();
+    this->sim_profiler.add("particles live", static_cast<double>(this->particles.size()));
+    this->sound_events.flush(this->frame++, this->audio_queue);
 
-        SDL_RenderCopy(this->renderer.get(), this->backgroud.get(), nullptr, nullptr);
+    if (this->replay || !this->record_path.empty())
+    {
+        Uint32 checksum = this->state_checksum();
+        if (this->replay)
+        {
+            if (!this->replay_divergence && this->replay->ticks[this->replay_tick].checksum != checksum)
+            {
+                this->replay_divergence = this->replay_tick;
+            }
+            ++this->replay_tick;
+        }
+        if (!this->record_path.empty())
+        {
+            this->recording.ticks.push_back({input, checksum});
+        }
+    }
+    return !input.was_pressed(InputQuit) && !(this->replay && this->replay_tick == this->replay->ticks.size());
+}
 
-        SDL_RenderCopy(this->renderer.get(), this->text.get(), nullptr, &this->text_rect);
+Uint32 Game::state_checksum() const
+{
+    Uint32 hash = 2166136261u;
+    hash = checksum_bytes(hash, this->entities.x(), this->entities.size() * sizeof(float));
+    hash = checksum_bytes(hash, this->entities.y(), this->entities.size() * sizeof(float));
+    hash = checksum_bytes(hash, &this->sprite_rect, sizeof(this->sprite_rect));
+    std::size_t counts[] = {this->bullets.size(), this->particles.size()};
+    hash = checksum_bytes(hash, counts, sizeof(counts));
+    return checksum_bytes(hash, &this->clear_color, sizeof(this->clear_color));
+}
 
-        SDL_RenderCopy(this->renderer.get(), this->sprite.get(), nullptr, &this->sprite_rect);
+// The cached static layers as a fixed backdrop, or the 4096x4096-tile map in world space.
+void Game::render_background(const Camera &camera)
+{
+    if (!this->show_tilemap)
+    {
+        int rebuilds = this->static_layers.rebuilds();
+        this->static_layers.draw(this->renderer.get());
+        this->render_profiler.add("static layer rebuilds", this->static_layers.rebuilds() - rebuilds);
+        return;
+    }
 
+    constexpr int tile_size = 16;
+    constexpr int tile_kinds = 8;
+    if (!this->tilemap)
+    {
+        this->tilemap = this->tilemap_path.empty() ? Tilemap::generate(4096, 4096, tile_size, tile_kinds, 1)
+                                                   : Tilemap::load(this->tilemap_path);
+        this->tileset.reset(create_debug_tileset(this->renderer.get(), this->tilemap->tile_size(), tile_kinds));
+        this->tilemap_renderer.emplace(*this->tilemap, this->tileset.get());
+    }
+
+    this->tilemap_renderer->draw(this->renderer.get(), camera);
+
+    auto stats = this->tilemap_renderer->stats();
+    this->render_profiler.add("tilemap chunks drawn", stats.chunks_drawn);
+    this->render_profiler.add("tilemap chunks rendered", stats.chunks_rendered);
+}
+
+/*
+With the software renderer, texts and the sprite skip SDL's per-pixel blend
+loop: the static layers are read back once per rebuild, copied into a
+streaming texture every frame and the sprites blended over them by
+SoftCompositor, then the whole frame goes out as one unblended copy.
+*/
+void Game::use_soft_compositor()
+{
+    this->soft_sprites.emplace(this->text.get(), premultiplied_copy(this->text_surface.get()));
+    this->soft_sprites.emplace(this->sprite.get(), premultiplied_copy(this->icon_surface.get()));
+    this->soft_background.reset(
+        SDL_CreateRGBSurfaceWithFormat(0, this->width, this->height, 32, SDL_PIXELFORMAT_ARGB8888));
+    if (!this->soft_background)
+    {
+        auto error = std::format("Error creating software frame: {}", SDL_GetError());
+        throw std::runtime_error(error);
+    }
+    this->soft_frame.emplace(this->renderer.get(), this->width, this->height);
+    this->soft_frame->set_blend_mode(SDL_BLENDMODE_NONE);
+}
+
+void Game::render_software(const FrameSnapshot &snapshot)
+{
+    if (this->static_layers.stale())
+    {
+        this->static_layers.draw(this->renderer.get());
+        SDL_RenderReadPixels(this->renderer.get(), nullptr, SDL_PIXELFORMAT_ARGB8888, this->soft_background->pixels,
+                             this->soft_background->pitch);
+    }
+
+    Uint32 *pixels = this->soft_frame->pixels();
+    int pitch = this->soft_frame->pitch() * static_cast<int>(sizeof(Uint32));
+    for (int y = 0; y < this->height; ++y)
+    {
+        std::memcpy(pixels + y * this->soft_frame->pitch(),
+                    static_cast<const Uint8 *>(this->soft_background->pixels) + y * this->soft_background->pitch,
+                    this->width * sizeof(Uint32));
+    }
+
+    for (std::size_t i = 0; i < snapshot.texts.size(); ++i)
+    {
+        auto found = this->soft_sprites.find(snapshot.text_textures[i]);
+        if (found != this->soft_sprites.end())
+        {
+            SDL_FPoint at = snapshot.camera.to_screen(snapshot.texts[i].x, snapshot.texts[i].y);
+            this->compositor.add(found->second.get(), static_cast<int>(std::lround(at.x)),
+                                 static_cast<int>(std::lround(at.y)));
+        }
+    }
+    SDL_FPoint at = snapshot.camera.to_screen(snapshot.sprite_rect.x, snapshot.sprite_rect.y);
+    this->compositor.add(this->soft_sprites.at(this->sprite.get()).get(), static_cast<int>(std::lround(at.x)),
+                         static_cast<int>(std::lround(at.y)));
+    this->compositor.flush(pixels, pitch, this->width, this->height);
+    this->soft_frame->mark_dirty({0, 0, this->width, this->height});
+    SDL_RenderCopy(this->renderer.get(), this->soft_frame->present(), nullptr, nullptr);
+
+    this->render_profiler.add("soft blended pixels", static_cast<double>(this->compositor.stats().pixels));
+}
+
+/*
+Press N for a quarter-scale map of the texts and the sprite, top right.
+Only the dots drawn last frame are erased and this frame's plotted, so the
+upload is the box around both rather than the whole map.
+*/
+void Game::render_minimap(const FrameSnapshot &snapshot)
+{
+    constexpr int scale = 4;
+    constexpr Uint32 background = 0xc0102030;
+    if (!this->show_minimap)
+    {
+        return;
+    }
+    if (!this->minimap)
+    {
+        this->minimap.emplace(this->renderer.get(), this->width / scale, this->height / scale);
+        this->minimap->set_blend_mode(SDL_BLENDMODE_BLEND);
+        std::fill_n(this->minimap->pixels(), this->minimap->w() * this->minimap->h(), background);
+        this->minimap->invalidate();
+        this->minimap_drawn = {0, 0, 0, 0};
+    }
+
+    StreamingTexture &map = *this->minimap;
+    Uint32 *pixels = map.pixels();
+    const SDL_Rect &previous = this->minimap_drawn;
+    for (int y = previous.y; y < previous.y + previous.h; ++y)
+    {
+        std::fill_n(pixels + y * map.pitch() + previous.x, previous.w, background);
+    }
+    map.mark_dirty(previous);
+
+    SDL_Rect drawn{0, 0, 0, 0};
+    auto plot = [&](float x, float y, int size, Uint32 color)
+    {
+        SDL_Rect dot{static_cast<int>(x) / scale, static_cast<int>(y) / scale, size, size};
+        SDL_Rect bounds{0, 0, map.w(), map.h()};
+        if (!SDL_IntersectRect(&dot, &bounds, &dot))
+        {
+            return;
+        }
+        for (int row = dot.y; row < dot.y + dot.h; ++row)
+        {
+            std::fill_n(pixels + row * map.pitch() + dot.x, dot.w, color);
+        }
+        if (SDL_RectEmpty(&drawn))
+        {
+            drawn = dot;
+        }
+        else
+        {
+            SDL_UnionRect(&drawn, &dot, &drawn);
+        }
+    };
+    for (const SDL_FRect &text : snapshot.texts)
+    {
+        plot(text.x + text.w / 2, text.y + text.h / 2, 1, 0xffffffff);
+    }
+    const SDL_Rect &sprite = snapshot.sprite_rect;
+    plot(sprite.x + sprite.w / 2.0f, sprite.y + sprite.h / 2.0f, 3, 0xffffdc40);
+    map.mark_dirty(drawn);
+    this->minimap_drawn = drawn;
+
+    std::size_t uploaded = map.stats().bytes_uploaded;
+    SDL_Rect dst{this->width - map.w() - 8, 8, map.w(), map.h()};
+    SDL_RenderCopy(this->renderer.get(), map.present(), nullptr, &dst);
+    this->render_profiler.add("minimap bytes uploaded", static_cast<double>(map.stats().bytes_uploaded - uploaded));
+}
+
+/*
+The labels come from the text cache in pieces: the fixed words whole, the
+numbers one digit at a time. A changing number then only ever looks up the
+same eleven glyphs, so the HUD stops rasterizing once they are cached, and
+the digits are formatted into a stack buffer rather than a std::string.
+*/
+void Game::render_hud(const FrameSnapshot &snapshot)
+{
+    if (!this->show_hud)
+    {
+        return;
+    }
+    const SDL_Color color{255, 255, 255, 255};
+    float x = 8.0f;
+    float y = 8.0f;
+    auto text = [&](std::string_view piece)
+    {
+        TextCache::Entry entry = this->text_cache->get(this->hud_font.get(), hud_font_size, color, piece);
+        this->draw_commands.copy(LayerHud, 0, entry.texture, nullptr,
+                                 {x, y, static_cast<float>(entry.w), static_cast<float>(entry.h)});
+        x += static_cast<float>(entry.w);
+    };
+    auto number = [&](long long value)
+    {
+        char digits[24];
+        const char *end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+        for (const char *digit = digits; digit != end; ++digit)
+        {
+            text({digit, 1});
+        }
+    };
+    auto next_line = [&]
+    {
+        x = 8.0f;
+        y += static_cast<float>(TTF_FontLineSkip(this->hud_font.get()));
+    };
+
+    text("texts ");
+    number(static_cast<long long>(snapshot.texts.size()));
+    next_line();
+    text("bullets ");
+    number(static_cast<long long>(snapshot.bullets.size()));
+    next_line();
+    text("particles ");
+    number(static_cast<long long>(snapshot.particles.size() / 1000));
+    text("k");
+    next_line();
+    text("sprite ");
+    number(snapshot.sprite_rect.x);
+    text(", ");
+    number(snapshot.sprite_rect.y);
+
+    // Over the particles and the minimap, so the HUD gets a flush of its own.
+    this->draw_commands.flush(this->renderer.get());
+    this->text_cache->end_frame();
+}
+
+void Game::render(const FrameSnapshot &snapshot)
+{
+    Profiler::Scope scope{this->render_profiler, "render ms"};
+    this->draw_frame(snapshot);
+    if (this->capture)
+    {
+        Profiler::Scope capture_scope{this->render_profiler, "capture ms"};
+        this->capture->capture(this->renderer.get());
+    }
+    SDL_RenderPresent(this->renderer.get());
+}
+
+// Everything up to SDL_RenderPresent, so callers can read the frame back first.
+void Game::draw_frame(const FrameSnapshot &snapshot)
+{
+    const SDL_Color &clear = snapshot.clear_color;
+    SDL_SetRenderDrawColor(this->renderer.get(), clear.r, clear.g, clear.b, clear.a);
+    SDL_RenderClear(this->renderer.get());
+
+    // The compositor only blits unscaled sprites.
+    if (this->soft_frame && !this->show_tilemap && snapshot.camera.zoom() == 1.0f)
+    {
+        this->render_software(snapshot);
+        this->draw_commands.set_camera(&snapshot.camera);
+    }
+    else
+    {
+        this->render_background(snapshot.camera);
+        this->draw_commands.set_camera(&snapshot.camera);
+        this->render_visible(snapshot);
+    }
+    this->render_bullets(snapshot);
+    this->draw_commands.flush(this->renderer.get());
+    this->draw_commands.set_camera(nullptr);
+    auto commands = this->draw_commands.stats();
+    this->render_particles(snapshot);
+    this->render_minimap(snapshot);
+    this->render_hud(snapshot);
+
+    this->render_profiler.add("draw commands", static_cast<double>(commands.commands));
+    this->render_profiler.add("state changes submitted", static_cast<double>(commands.state_changes_submitted));
+    this->render_profiler.add("state changes sorted", static_cast<double>(commands.state_changes_sorted));
+    this->render_profiler.add("draw calls", static_cast<double>(commands.draw_calls));
+    this->render_profiler.add("particles drawn", static_cast<double>(snapshot.particles.size()));
+}
+
+// Copies what the render thread draws into the back slot of the triple buffer.
+void Game::publish()
+{
+    FrameSnapshot &snapshot = this->snapshots.back();
+    snapshot.tick = this->frame;
+    snapshot.clear_color = this->clear_color;
+    snapshot.sprite_rect = this->sprite_rect;
+    snapshot.camera = this->camera;
+    this->collect_visible(snapshot);
+    snapshot.bullets.clear();
+    this->bullets.for_each([&](PoolHandle, const Bullet &bullet)
+                           { snapshot.bullets.push_back({bullet.x, bullet.y, 4.0f, 8.0f}); });
+    this->particles.snapshot(snapshot.particles);
+    this->snapshots.publish();
+}
+
+/*
+Simulation thread. Fixed timestep: the simulation advances in whole ticks of
+1/tick_rate s however long frames take, publishing a snapshot after each one.
+Replays skip the clock and run as fast as the machine allows.
+*/
+void Game::simulate()
+{
+    AllocTracker::Scope alloc_scope{AllocSite::Simulate};
+    try
+    {
+        // Its own job queue, so update_text never runs the render thread's compositor bands.
+        JobSystem::ThreadScope job_scope{this->jobs};
+        const Uint64 frequency = SDL_GetPerformanceFrequency();
+        const Uint64 tick_counts = frequency / this->tick_rate;
+        Uint64 previous = SDL_GetPerformanceCounter();
+        Uint64 accumulator = tick_counts;
+
+        while (this->sim_running.load(std::memory_order_acquire))
+        {
+            Uint64 now = SDL_GetPerformanceCounter();
+            accumulator += now - previous;
+            previous = now;
+            if (this->replay)
+            {
+                accumulator = tick_counts;
+            }
+
+            // Never try to catch up more than a few ticks after a stall.
+            accumulator = std::min(accumulator, tick_counts * 5);
+            while (accumulator >= tick_counts)
+            {
+                accumulator -= tick_counts;
+                bool running = this->tick(this->next_input());
+                this->publish();
+                this->sim_profiler.end_frame();
+                if (!running)
+                {
+                    this->sim_running.store(false, std::memory_order_release);
+                    break;
+                }
+            }
+
+            if (!this->replay)
+            {
+                Uint64 elapsed = SDL_GetPerformanceCounter() - previous + accumulator;
+                if (elapsed < tick_counts)
+                {
+                    SDL_Delay(static_cast<Uint32>((tick_counts - elapsed) * 1000 / frequency));
+                }
+            }
+        }
+    }
+    catch (...)
+    {
+        this->sim_error = std::current_exception();
+        this->sim_running.store(false, std::memory_order_release);
+    }
+}
+
+/*
+The main thread keeps the window and renderer: it polls events, samples the
+keyboard for the simulation thread and draws the newest snapshot whenever one
+has arrived. Neither thread waits for the other, so the render rate is
+whatever the renderer manages and the simulation rate stays tick_rate.
+*/
+void Game::run()
+{
+    if (Mix_PlayMusic(this->music.get(), -1))
+    {
+        auto error = std::format("Error playing Music: {}", Mix_GetError());
+        throw std::runtime_error(error);
+    }
+
+    this->audio_queue.install();
+
+    if (!this->capture_path.empty())
+    {
+        std::filesystem::path path{this->capture_path};
+        this->capture.emplace(path, path.extension() == ".y4m" ? CaptureFormat::Y4m : CaptureFormat::Png,
+                              this->width, this->height, this->tick_rate);
+    }
+
+    // Job workers, the audio callback and capture encoders have no scope of their own.
+    AllocTracker::set_phase(AllocSite::Background);
+    AllocTracker::Scope alloc_scope{AllocSite::Render};
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    this->sim_running.store(true);
+    this->sim_thread = std::thread{[this] { this->simulate(); }};
+    auto stop = [this]
+    {
+        AllocTracker::end_steady_state();
+        AllocTracker::set_phase(AllocSite::Shutdown);
+        this->sim_running.store(false, std::memory_order_release);
+        this->sim_thread.join();
+    };
+
+    try
+    {
+        while (this->sim_running.load(std::memory_order_acquire) && this->poll_events())
+        {
+            auto held = [&](SDL_Scancode a, SDL_Scancode b) { return this->keystate[a] || this->keystate[b]; };
+            Uint16 bits = (held(SDL_SCANCODE_LEFT, SDL_SCANCODE_A) << InputLeft) |
+                          (held(SDL_SCANCODE_RIGHT, SDL_SCANCODE_D) << InputRight) |
+                          (held(SDL_SCANCODE_UP, SDL_SCANCODE_W) << InputUp) |
+                          (held(SDL_SCANCODE_DOWN, SDL_SCANCODE_S) << InputDown) |
+                          (this->keystate[SDL_SCANCODE_F] << InputFire) |
+                          (held(SDL_SCANCODE_EQUALS, SDL_SCANCODE_KP_PLUS) << InputZoomIn) |
+                          (held(SDL_SCANCODE_MINUS, SDL_SCANCODE_KP_MINUS) << InputZoomOut);
+            this->held_keys.store(bits, std::memory_order_relaxed);
+
+            const FrameSnapshot *snapshot = this->snapshots.acquire();
+            if (!snapshot)
+            {
+                SDL_Delay(1);
+                continue;
+            }
+            this->render(*snapshot);
+            this->render_profiler.end_frame();
+            if (this->render_profiler.frames() == steady_state_after)
+            {
+                AllocTracker::begin_steady_state();
+            }
+        }
+    }
+    catch (...)
+    {
+        stop();
+        throw;
+    }
+    stop();
+    this->run_seconds = seconds_since(start);
+
+    if (this->sim_error)
+    {
+        std::rethrow_exception(this->sim_error);
+    }
+    if (this->capture)
+    {
+        this->capture->finish();
+    }
+    if (!this->record_path.empty())
+    {
+        this->recording.save(this->record_path);
+    }
+}
+
+/*
+Golden-image mode: the replay is stepped on the calling thread, with no
+clock, and each tick in `ticks` (ascending) is drawn and read back as RGB888.
+*/
+std::vector<SurfacePtr> Game::render_ticks(const std::vector<Uint64> &ticks)
+{
+    std::vector<SurfacePtr> frames;
+    for (Uint64 at : ticks)
+    {
+        while (this->frame < at)
+        {
+            if (!this->replay || this->replay_tick == this->replay->ticks.size())
+            {
+                auto error = std::format("Error rendering tick {}: the replay ends at tick {}", at, this->frame);
+                throw std::runtime_error(error);
+            }
+            this->tick(this->next_input());
+            this->publish();
+            this->sim_profiler.end_frame();
+        }
+
+        const FrameSnapshot *snapshot = this->snapshots.acquire();
+        if (!snapshot)
+        {
+            auto error = std::format("Error rendering tick {}: nothing was published", at);
+            throw std::runtime_error(error);
+        }
+        this->draw_frame(*snapshot);
+        SurfacePtr pixels{SDL_CreateRGBSurfaceWithFormat(0, this->width, this->height, 32, SDL_PIXELFORMAT_RGB888),
+                          SDL_FreeSurface};
+        if (!pixels || SDL_RenderReadPixels(this->renderer.get(), nullptr, SDL_PIXELFORMAT_RGB888, pixels->pixels,
+                                            pixels->pitch))
+        {
+            auto error = std::format("Error reading back tick {}: {}", at, SDL_GetError());
+            throw std::runtime_error(error);
+        }
         SDL_RenderPresent(this->renderer.get());
-        // 1000/60  milliseconds/seconds 1second 1 frame;
-        SDL_Delay(16);
+        this->render_profiler.end_frame();
+        frames.push_back(std::move(pixels));
     }
+    return frames;
+}
+
+void Game::report() const
+{
+    std::cout << std::format("entities: {} after {} ticks", this->entities.size(), this->frame) << std::endl;
+
+    if (this->replay)
+    {
+        std::cout << std::format("replay: {} of {} ticks, ", this->replay_tick, this->replay->ticks.size());
+        if (this->replay_divergence)
+        {
+            std::cout << std::format("state diverged at tick {}", *this->replay_divergence) << std::endl;
+        }
+        else
+        {
+            std::cout << "state matched the recording" << std::endl;
+        }
+    }
+    else if (!this->record_path.empty())
+    {
+        std::cout << std::format("recorded {} ticks (seed {}) to {}", this->recording.ticks.size(),
+                                 this->recording.seed, this->record_path)
+                  << std::endl;
+    }
+
+    this->render_probe.report(std::cout);
+    auto report_streaming = [](std::string_view name, const std::optional<StreamingTexture> &streaming)
+    {
+        if (streaming)
+        {
+            auto stats = streaming->stats();
+            std::cout << std::format("{}: {} streaming textures, {} uploads, {:.1f} MiB uploaded", name,
+                                     stats.textures_created, stats.uploads, stats.bytes_uploaded / 1048576.0)
+                      << std::endl;
+        }
+    };
+    report_streaming("software frame", this->soft_frame);
+    report_streaming("minimap", this->minimap);
+
+    if (this->capture)
+    {
+        auto capture = this->capture->stats();
+        double encoded = std::max<double>(capture.encoded, 1.0);
+        std::cout << std::format("capture: {} frames to {} ({}), {} dropped; {:.1f} frames/s encoded, "
+                                 "{:.2f} ms readback and {:.2f} ms encode per frame, {:.1f} MiB written",
+                                 capture.captured, this->capture->path().string(), to_string(this->capture->kind()),
+                                 capture.dropped, capture.encoded / std::max(capture.seconds, 1e-9),
+                                 capture.readback_ms / std::max<double>(capture.captured, 1.0),
+                                 capture.encode_ms / encoded, capture.bytes_written / 1048576.0)
+                  << std::endl;
+    }
+
+    if (this->text_cache)
+    {
+        auto texts = this->text_cache->stats();
+        std::cout << std::format("text cache: {:.1f}% hits ({} hits, {} misses), {} evictions, "
+                                 "{} textures, {:.1f} KiB resident",
+                                 this->text_cache->hit_rate() * 100.0, texts.hits, texts.misses, texts.evictions,
+                                 texts.entries, texts.bytes / 1024.0)
+                  << std::endl;
+    }
+
+    auto tree = this->view_tree.stats();
+    std::cout << std::format("view tree: {} proxies, {} nodes, height {}", tree.proxies, tree.nodes, tree.height)
+              << std::endl;
+
+    auto pool = this->bullets.stats();
+    std::cout << std::format("bullet pool: {} live (peak {}), capacity {} in {} blocks, {} created, {} destroyed",
+                             pool.live, pool.peak, pool.capacity, pool.blocks, pool.created, pool.destroyed)
+              << std::endl;
+
+    double seconds = std::max(this->run_seconds, 1e-9);
+    std::cout << std::format("simulation: {} ticks at {:.1f} ticks/s", this->sim_profiler.frames(),
+                             this->sim_profiler.frames() / seconds)
+              << std::endl;
+    std::cout << std::format("render: {} frames at {:.1f} frames/s; {} snapshots published, {} replaced unseen",
+                             this->render_profiler.frames(), this->render_profiler.frames() / seconds,
+                             this->snapshots.published(), this->snapshots.dropped())
+              << std::endl;
+
+    this->sim_profiler.report(std::cout);
+    this->render_profiler.report(std::cout);
+
+    AllocTracker::report(std::cout);
+
+    auto audio = this->audio_queue.stats();
+    std::cout << std::format("audio queue: depth {} (max {}), pushed {}, dropped {}, applied {}",
+                             audio.depth, audio.max_depth, audio.pushed, audio.dropped, audio.applied)
+              << std::endl;
+
+    auto sounds = this->sound_events.total();
+    std::cout << std::format("sound events: {} triggers over {} frames, {} merged (max {} in a frame), "
+                             "{} throttled, {} culled, {} submitted",
+                             sounds.triggers, sounds.frames, sounds.merged, sounds.max_merged, sounds.throttled,
+                             sounds.culled, sounds.submitted)
+              << std::endl;
 }
 
 /*
@@ -248,9 +1539,8 @@ BMP JPG PNG TIF
 
 */
 
-void initialize_sdl()
+void initialize_sdl(Uint32 sdl_flags)
 {
-    int sdl_flags = SDL_INIT_EVERYTHING;
     int img_flags = IMG_INIT_PNG;
     int mix_flags = MIX_INIT_OGG;
 
@@ -276,27 +1566,295 @@ void initialize_sdl()
         auto error = std::format("Error initialized SDL_mixer: {}", Mix_GetError());
         throw std::runtime_error(error);
     }
+
+    if ((sdl_flags & SDL_INIT_AUDIO) &&
+        Mix_OpenAudio(MIX_DEFAULT_FREQUENCY, MIX_DEFAULT_FORMAT, MIX_DEFAULT_CHANNELS, 1024))
+    {
+        auto error = std::format("Error opening audio device: {}", Mix_GetError());
+        throw std::runtime_error(error);
+    }
 }
 
 void close_sdl()
 {
+    Mix_CloseAudio();
     Mix_Quit();
     TTF_Quit();
     IMG_Quit();
     SDL_Quit();
 }
 
-int main(int arg, char **args)
+// Mixes a fixed script of music and effects to a WAV file, as fast as the CPU allows.
+void render_audio(const std::string &path)
 {
-    int exit_val = EXIT_SUCCESS;
+    PcmCache pcm_cache{"cache/pcm"};
+    PcmCache::Chunk c_sound = pcm_cache.load("sounds/C.ogg");
+    PcmCache::Chunk sdl_sound = pcm_cache.load("sounds/SDL.ogg");
 
-    try
+    std::unique_ptr<Mix_Music, decltype(&Mix_FreeMusic)> music{
+        Mix_LoadMUS("music/freesoftwaresong-8bit.ogg"), Mix_FreeMusic};
+    if (!music)
     {
-        initialize_sdl();
+        auto error = std::format("Error loading Music: {}", Mix_GetError());
+        throw std::runtime_error(error);
+    }
+
+    int frequency = 0;
+    Mix_QuerySpec(&frequency, nullptr, nullptr);
+    Uint64 second = static_cast<Uint64>(frequency);
+
+    std::vector<ScriptedCommand> script{
+        {0, AudioCommand::play_music(music.get(), 0)},
+        {second / 2, AudioCommand::play(sdl_sound.get())},
+        {second * 2, AudioCommand::play(c_sound.get())},
+        {second * 3, AudioCommand::music_volume(MIX_MAX_VOLUME / 4)},
+        {second * 4, AudioCommand::play(sdl_sound.get())},
+        {second * 4, AudioCommand::play(c_sound.get())},
+        {second * 5, AudioCommand::halt_music()},
+    };
+
+    OfflineAudioRenderer offline{std::move(script), second * 6};
+    auto result = offline.render();
+    offline.write_wav(path);
+
+    std::cout << std::format("rendered {} frames x {} channels in {:.3f} s: {:.0f} samples/s ({:.1f}x realtime)",
+                             result.frames, result.channels, result.seconds, result.samples_per_second,
+                             result.realtime_factor)
+              << std::endl;
+}
+
+struct GoldenScene
+{
+    const char *name;
+    std::vector<Uint64> captures;
+    InputFrame (*input)(Uint64 tick);
+};
+
+/*
+Plays each scene's scripted input from a fixed seed in a headless Game and
+compares the frames drawn after the listed ticks with <directory>/<scene>-<tick>.png.
+Failures leave the actual frame and a diff image under <directory>/failed.
+--golden-update rewrites the golden images instead; `make golden-update`
+regenerates the ones under golden/ and `make golden` checks against them.
+A scene with no golden image fails, so a missing set is never a pass.
+*/
+bool run_golden(const std::filesystem::path &directory, bool update, int tolerance)
+{
+    const GoldenScene scenes[] = {
+        {"idle", {1, 60}, [](Uint64) { return InputFrame{0, 0}; }},
+        {"move-and-fire", {20, 45},
+         [](Uint64 tick)
+         {
+             Uint16 held = (1u << InputRight) | (1u << InputDown) | (tick >= 10 ? 1u << InputFire : 0u);
+             return InputFrame{held, 0};
+         }},
+        {"sparks", {8, 30},
+         [](Uint64 tick)
+         {
+             Uint16 pressed = tick == 1 ? 1u << InputSpawn : tick == 4 ? 1u << InputColor : 0u;
+             return InputFrame{0, pressed};
+         }},
+        {"fountain", {45},
+         [](Uint64 tick)
+         {
+             Uint16 pressed = tick == 0 ? 1u << InputFountain : 0u;
+             return InputFrame{0, pressed};
+         }},
+        // Zoomed in, so the draw-command path renders instead of the software compositor.
+        {"zoom", {40},
+         [](Uint64 tick)
+         {
+             Uint16 held = tick < 35 ? 1u << InputZoomIn : 0u;
+             return InputFrame{held, 0};
+         }},
+    };
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    int frames = 0, failures = 0;
+    for (const GoldenScene &scene : scenes)
+    {
+        InputRecording script;
+        script.seed = 1;
+        script.tick_rate = Game::tick_rate;
+        for (Uint64 tick = 0; tick <= scene.captures.back(); ++tick)
+        {
+            script.ticks.push_back({scene.input(tick), 0});
+        }
+
         Game game;
+        game.replay_inputs(std::move(script), scene.name);
+        game.run_headless();
         game.init();
         game.load_media();
-        game.run();
+        std::vector<SurfacePtr> actual = game.render_ticks(scene.captures);
+
+        for (std::size_t i = 0; i < actual.size(); ++i)
+        {
+            ++frames;
+            std::string name = std::format("{}-{:04}.png", scene.name, scene.captures[i]);
+            if (update)
+            {
+                save_png(actual[i].get(), directory / name);
+                std::cout << std::format("golden {:<24} updated", name) << std::endl;
+                continue;
+            }
+
+            SurfacePtr expected = load_rgb(directory / name);
+            if (!expected)
+            {
+                ++failures;
+                save_png(actual[i].get(), directory / "failed" / name);
+                std::cout << std::format("golden {:<24} FAILED: no golden image", name) << std::endl;
+                continue;
+            }
+            ImageDiff diff = diff_images(actual[i].get(), expected.get(), tolerance);
+            if (diff.differing)
+            {
+                ++failures;
+                save_png(actual[i].get(), directory / "failed" / name);
+                save_png(diff_image(actual[i].get(), expected.get(), tolerance).get(),
+                         directory / "failed" / std::format("{}-{:04}-diff.png", scene.name, scene.captures[i]));
+                std::cout << std::format("golden {:<24} FAILED: {} of {} pixels differ (max delta {})", name,
+                                         diff.differing, diff.pixels, diff.max_delta)
+                          << std::endl;
+            }
+            else
+            {
+                std::cout << std::format("golden {:<24} ok (max delta {})", name, diff.max_delta) << std::endl;
+            }
+        }
+    }
+
+    std::cout << std::format("golden: {} of {} frames match ({} kernel, tolerance {}) in {:.2f} s",
+                             frames - failures, frames, to_string(best_blend_kernel()), tolerance,
+                             seconds_since(start))
+              << std::endl;
+    return failures == 0;
+}
+
+int main(int arg, char **args)
+{
+    int exit_val = EXIT_SUCCESS;
+
+    std::string render_audio_path;
+    std::string bench_name;
+    std::string record_path;
+    std::string replay_path;
+    std::string tilemap_path;
+    std::string capture_path;
+    std::string golden_path;
+    bool golden_update = false;
+    int golden_tolerance = 2;
+    bool probe_renderer = false;
+    for (int i = 1; i < arg; ++i)
+    {
+        std::string_view option{args[i]};
+        if (option == "--render-audio" && i + 1 < arg)
+        {
+            render_audio_path = args[++i];
+        }
+        else if (option == "--bench" && i + 1 < arg)
+        {
+            bench_name = args[++i];
+        }
+        else if (option == "--record" && i + 1 < arg)
+        {
+            record_path = args[++i];
+        }
+        else if (option == "--replay" && i + 1 < arg)
+        {
+            replay_path = args[++i];
+        }
+        else if (option == "--tilemap" && i + 1 < arg)
+        {
+            tilemap_path = args[++i];
+        }
+        else if (option == "--capture" && i + 1 < arg)
+        {
+            capture_path = args[++i];
+        }
+        else if (option == "--golden" && i + 1 < arg)
+        {
+            golden_path = args[++i];
+        }
+        else if (option == "--golden-update")
+        {
+            golden_update = true;
+        }
+        else if (option == "--golden-tolerance" && i + 1 < arg)
+        {
+            golden_tolerance = std::clamp(std::atoi(args[++i]), 0, 255);
+        }
+        else if (option == "--probe-renderer")
+        {
+            probe_renderer = true;
+        }
+        else if (option == "--resampler" && i + 1 < arg)
+        {
+            std::string_view quality{args[++i]};
+            for (auto q : {ResampleQuality::Nearest, ResampleQuality::Linear, ResampleQuality::Sinc})
+            {
+                if (quality == to_string(q))
+                {
+                    Resampler::set_default_quality(q);
+                }
+            }
+        }
+    }
+
+    try
+    {
+        AllocTracker::install_sdl();
+        if (!bench_name.empty())
+        {
+            initialize_sdl(0);
+            run_benchmarks(bench_name);
+        }
+        else if (!golden_path.empty())
+        {
+            SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+            SDL_SetHint(SDL_HINT_AUDIODRIVER, "dummy");
+            initialize_sdl();
+            if (!run_golden(golden_path, golden_update, golden_tolerance))
+            {
+                exit_val = EXIT_FAILURE;
+            }
+        }
+        else if (!render_audio_path.empty())
+        {
+            OfflineAudioRenderer::use_disk_driver();
+            initialize_sdl(SDL_INIT_AUDIO);
+            render_audio(render_audio_path);
+        }
+        else
+        {
+            initialize_sdl();
+            Game game;
+            if (!replay_path.empty())
+            {
+                game.replay_from(replay_path);
+            }
+            if (!record_path.empty())
+            {
+                game.record_to(record_path);
+            }
+            if (!tilemap_path.empty())
+            {
+                game.use_tilemap(tilemap_path);
+            }
+            if (!capture_path.empty())
+            {
+                game.capture_to(capture_path);
+            }
+            if (probe_renderer)
+            {
+                game.reprobe_renderer();
+            }
+            game.init();
+            game.load_media();
+            game.run();
+            game.report();
+        }
     }
     catch (const std::runtime_error &e)
     {
@@ -306,5 +1864,5 @@ int main(int arg, char **args)
 
     close_sdl();
 
-    return 0;
+    return exit_val;
 }
\ No newline at end of file
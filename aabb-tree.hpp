@@ -0,0 +1,471 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+struct Aabb
+{
+    float left;
+    float top;
+    float right;
+    float bottom;
+
+    static Aabb from_rect(const SDL_FRect &rect) { return {rect.x, rect.y, rect.x + rect.w, rect.y + rect.h}; }
+
+    bool overlaps(const Aabb &other) const
+    {
+        return this->left < other.right && other.left < this->right && this->top < other.bottom &&
+               other.top < this->bottom;
+    }
+
+    bool contains(const Aabb &other) const
+    {
+        return this->left <= other.left && this->top <= other.top && other.right <= this->right &&
+               other.bottom <= this->bottom;
+    }
+
+    // 2D stand-in for surface area in the insertion cost.
+    float perimeter() const { return 2.0f * ((this->right - this->left) + (this->bottom - this->top)); }
+
+    static Aabb merge(const Aabb &a, const Aabb &b)
+    {
+        return {std::min(a.left, b.left), std::min(a.top, b.top), std::max(a.right, b.right),
+                std::max(a.bottom, b.bottom)};
+    }
+};
+
+/*
+Dynamic bounding-volume tree over moving boxes.
+
+Leaves hold a "fat" box: the real box grown by a margin and stretched along
+the last displacement. move() is a no-op while the real box stays inside its
+fat box, so slow objects touch the tree only every few frames. Insertion
+walks down picking the child with the lowest perimeter growth and the path
+back up is rebalanced with AVL-style rotations, keeping the height near
+log2(n). Nodes live in one vector with a free list, so proxies are stable
+ints and nothing is allocated once the pool has grown.
+*/
+class AabbTree
+{
+public:
+    static constexpr int null_node = -1;
+
+    struct Stats
+    {
+        std::size_t proxies;
+        std::size_t nodes;
+        int height;
+        std::size_t reinserts;
+    };
+
+    explicit AabbTree(float margin = 8.0f, float displacement_scale = 4.0f)
+        : margin{margin}, displacement_scale{displacement_scale} {}
+
+    int create(const Aabb &box, Uint32 user)
+    {
+        int leaf = this->allocate();
+        Node &node = this->nodes[leaf];
+        node.box = this->fatten(box, 0.0f, 0.0f);
+        node.user = user;
+        node.height = 0;
+        this->insert_leaf(leaf);
+        ++this->proxy_count;
+        return leaf;
+    }
+
+    void destroy(int proxy)
+    {
+        this->remove_leaf(proxy);
+        this->release(proxy);
+        --this->proxy_count;
+    }
+
+    // Returns true if the proxy had to be reinserted.
+    bool move(int proxy, const Aabb &box, float dx, float dy)
+    {
+        if (this->nodes[proxy].box.contains(box))
+        {
+            return false;
+        }
+        this->remove_leaf(proxy);
+        this->nodes[proxy].box = this->fatten(box, dx, dy);
+        this->insert_leaf(proxy);
+        ++this->reinsert_count;
+        return true;
+    }
+
+    Uint32 user(int proxy) const { return this->nodes[proxy].user; }
+    void set_user(int proxy, Uint32 user) { this->nodes[proxy].user = user; }
+    const Aabb &fat_box(int proxy) const { return this->nodes[proxy].box; }
+
+    // fn(user) for every proxy whose fat box overlaps `box`; callers refine with the real box.
+    template <typename Fn>
+    void query(const Aabb &box, Fn &&fn) const
+    {
+        this->stack.clear();
+        this->stack.push_back(this->root);
+        while (!this->stack.empty())
+        {
+            int id = this->stack.back();
+            this->stack.pop_back();
+            if (id == null_node)
+            {
+                continue;
+            }
+            const Node &node = this->nodes[id];
+            if (!node.box.overlaps(box))
+            {
+                continue;
+            }
+            if (node.leaf())
+            {
+                fn(node.user);
+            }
+            else
+            {
+                this->stack.push_back(node.child1);
+                this->stack.push_back(node.child2);
+            }
+        }
+    }
+
+    /*
+    Segment (x0, y0) -> (x1, y1). fn(user, max_fraction) is called for every
+    proxy whose fat box the segment crosses before max_fraction and returns
+    the new max_fraction: the hit fraction to clip the ray, max_fraction to
+    ignore the proxy, 0 to stop.
+    */
+    template <typename Fn>
+    void raycast(float x0, float y0, float x1, float y1, Fn &&fn) const
+    {
+        float dx = x1 - x0;
+        float dy = y1 - y0;
+        float max_fraction = 1.0f;
+
+        this->stack.clear();
+        this->stack.push_back(this->root);
+        while (!this->stack.empty())
+        {
+            int id = this->stack.back();
+            this->stack.pop_back();
+            if (id == null_node)
+            {
+                continue;
+            }
+            const Node &node = this->nodes[id];
+            if (!segment_hits(node.box, x0, y0, dx, dy, max_fraction))
+            {
+                continue;
+            }
+            if (node.leaf())
+            {
+                max_fraction = fn(node.user, max_fraction);
+                if (max_fraction <= 0.0f)
+                {
+                    return;
+                }
+            }
+            else
+            {
+                this->stack.push_back(node.child1);
+                this->stack.push_back(node.child2);
+            }
+        }
+    }
+
+    // Entry fraction of the segment into `box`, or a value above max_fraction if it misses.
+    static float segment_entry(const Aabb &box, float x0, float y0, float dx, float dy, float max_fraction)
+    {
+        float t_min = 0.0f;
+        float t_max = max_fraction;
+        if (!clip_slab(box.left, box.right, x0, dx, t_min, t_max) ||
+            !clip_slab(box.top, box.bottom, y0, dy, t_min, t_max))
+        {
+            return max_fraction + 1.0f;
+        }
+        return t_min;
+    }
+
+    int height() const { return this->root == null_node ? 0 : this->nodes[this->root].height; }
+
+    Stats stats() const
+    {
+        return {this->proxy_count, this->nodes.size() - this->free_count, this->height(), this->reinsert_count};
+    }
+
+private:
+    struct Node
+    {
+        Aabb box;
+        int parent;
+        int child1;
+        int child2;
+        int height; // 0 for leaves, -1 for free nodes
+        Uint32 user;
+
+        bool leaf() const { return this->child1 == null_node; }
+    };
+
+    static bool clip_slab(float lo, float hi, float origin, float dir, float &t_min, float &t_max)
+    {
+        if (std::fabs(dir) < 1e-12f)
+        {
+            return origin >= lo && origin <= hi;
+        }
+        float inv = 1.0f / dir;
+        float t1 = (lo - origin) * inv;
+        float t2 = (hi - origin) * inv;
+        if (t1 > t2)
+        {
+            std::swap(t1, t2);
+        }
+        t_min = std::max(t_min, t1);
+        t_max = std::min(t_max, t2);
+        return t_min <= t_max;
+    }
+
+    static bool segment_hits(const Aabb &box, float x0, float y0, float dx, float dy, float max_fraction)
+    {
+        return segment_entry(box, x0, y0, dx, dy, max_fraction) <= max_fraction;
+    }
+
+    Aabb fatten(const Aabb &box, float dx, float dy) const
+    {
+        Aabb fat{box.left - this->margin, box.top - this->margin, box.right + this->margin,
+                 box.bottom + this->margin};
+        dx *= this->displacement_scale;
+        dy *= this->displacement_scale;
+        (dx < 0.0f ? fat.left : fat.right) += dx;
+        (dy < 0.0f ? fat.top : fat.bottom) += dy;
+        return fat;
+    }
+
+    int allocate()
+    {
+        int id;
+        if (this->free_list != null_node)
+        {
+            id = this->free_list;
+            this->free_list = this->nodes[id].parent;
+            --this->free_count;
+        }
+        else
+        {
+            id = static_cast<int>(this->nodes.size());
+            this->nodes.emplace_back();
+        }
+        this->nodes[id] = Node{{}, null_node, null_node, null_node, 0, 0};
+        return id;
+    }
+
+    // Free nodes chain through `parent`.
+    void release(int id)
+    {
+        this->nodes[id].parent = this->free_list;
+        this->nodes[id].height = -1;
+        this->free_list = id;
+        ++this->free_count;
+    }
+
+    void insert_leaf(int leaf)
+    {
+        if (this->root == null_node)
+        {
+            this->root = leaf;
+            this->nodes[leaf].parent = null_node;
+            return;
+        }
+
+        // Walk down to the cheapest sibling.
+        Aabb box = this->nodes[leaf].box;
+        int index = this->root;
+        while (!this->nodes[index].leaf())
+        {
+            const Node &node = this->nodes[index];
+            float area = node.box.perimeter();
+            float combined = Aabb::merge(node.box, box).perimeter();
+
+            // Cost of pairing with this node, and the minimum pushed down to its children.
+            float cost = 2.0f * combined;
+            float inheritance = 2.0f * (combined - area);
+
+            float cost1 = this->descend_cost(node.child1, box) + inheritance;
+            float cost2 = this->descend_cost(node.child2, box) + inheritance;
+            if (cost < cost1 && cost < cost2)
+            {
+                break;
+            }
+            index = cost1 < cost2 ? node.child1 : node.child2;
+        }
+
+        int sibling = index;
+        int old_parent = this->nodes[sibling].parent;
+        int new_parent = this->allocate();
+        this->nodes[new_parent].parent = old_parent;
+        this->nodes[new_parent].box = Aabb::merge(box, this->nodes[sibling].box);
+        this->nodes[new_parent].height = this->nodes[sibling].height + 1;
+        this->nodes[new_parent].child1 = sibling;
+        this->nodes[new_parent].child2 = leaf;
+        this->nodes[sibling].parent = new_parent;
+        this->nodes[leaf].parent = new_parent;
+
+        if (old_parent == null_node)
+        {
+            this->root = new_parent;
+        }
+        else if (this->nodes[old_parent].child1 == sibling)
+        {
+            this->nodes[old_parent].child1 = new_parent;
+        }
+        else
+        {
+            this->nodes[old_parent].child2 = new_parent;
+        }
+
+        this->refit(this->nodes[leaf].parent);
+    }
+
+    float descend_cost(int child, const Aabb &box) const
+    {
+        const Node &node = this->nodes[child];
+        float merged = Aabb::merge(box, node.box).perimeter();
+        return node.leaf() ? merged : merged - node.box.perimeter();
+    }
+
+    void remove_leaf(int leaf)
+    {
+        if (leaf == this->root)
+        {
+            this->root = null_node;
+            return;
+        }
+
+        int parent = this->nodes[leaf].parent;
+        int grand_parent = this->nodes[parent].parent;
+        int sibling = this->nodes[parent].child1 == leaf ? this->nodes[parent].child2 : this->nodes[parent].child1;
+
+        if (grand_parent == null_node)
+        {
+            this->root = sibling;
+            this->nodes[sibling].parent = null_node;
+            this->release(parent);
+            return;
+        }
+
+        if (this->nodes[grand_parent].child1 == parent)
+        {
+            this->nodes[grand_parent].child1 = sibling;
+        }
+        else
+        {
+            this->nodes[grand_parent].child2 = sibling;
+        }
+        this->nodes[sibling].parent = grand_parent;
+        this->release(parent);
+        this->refit(grand_parent);
+    }
+
+    // Rebalances and recomputes boxes and heights from `index` up to the root.
+    void refit(int index)
+    {
+        while (index != null_node)
+        {
+            index = this->balance(index);
+            Node &node = this->nodes[index];
+            const Node &a = this->nodes[node.child1];
+            const Node &b = this->nodes[node.child2];
+            node.height = 1 + std::max(a.height, b.height);
+            node.box = Aabb::merge(a.box, b.box);
+            index = node.parent;
+        }
+    }
+
+    // Rotates a grandchild up if one side is more than one level taller. Returns the new subtree root.
+    int balance(int a)
+    {
+        Node &node_a = this->nodes[a];
+        if (node_a.leaf() || node_a.height < 2)
+        {
+            return a;
+        }
+
+        int b = node_a.child1;
+        int c = node_a.child2;
+        int diff = this->nodes[c].height - this->nodes[b].height;
+        if (diff > 1)
+        {
+            return this->rotate(a, c, b, true);
+        }
+        if (diff < -1)
+        {
+            return this->rotate(a, b, c, false);
+        }
+        return a;
+    }
+
+    // Promotes `up` (a child of `a`) above `a`; `a` keeps `other` and the shorter grandchild.
+    int rotate(int a, int up, int other, bool up_is_child2)
+    {
+        int f = this->nodes[up].child1;
+        int g = this->nodes[up].child2;
+
+        this->nodes[up].child1 = a;
+        this->nodes[up].parent = this->nodes[a].parent;
+        this->nodes[a].parent = up;
+
+        int parent = this->nodes[up].parent;
+        if (parent == null_node)
+        {
+            this->root = up;
+        }
+        else if (this->nodes[parent].child1 == a)
+        {
+            this->nodes[parent].child1 = up;
+        }
+        else
+        {
+            this->nodes[parent].child2 = up;
+        }
+
+        // The taller grandchild stays under `up`, the other moves to `a`.
+        int keep = f;
+        int give = g;
+        if (this->nodes[f].height < this->nodes[g].height)
+        {
+            std::swap(keep, give);
+        }
+        this->nodes[up].child2 = keep;
+        if (up_is_child2)
+        {
+            this->nodes[a].child2 = give;
+        }
+        else
+        {
+            this->nodes[a].child1 = give;
+        }
+        this->nodes[give].parent = a;
+
+        Node &node_a = this->nodes[a];
+        node_a.box = Aabb::merge(this->nodes[other].box, this->nodes[give].box);
+        node_a.height = 1 + std::max(this->nodes[other].height, this->nodes[give].height);
+
+        Node &node_up = this->nodes[up];
+        node_up.box = Aabb::merge(node_a.box, this->nodes[keep].box);
+        node_up.height = 1 + std::max(node_a.height, this->nodes[keep].height);
+        return up;
+    }
+
+    float margin;
+    float displacement_scale;
+    std::vector<Node> nodes;
+    int root{null_node};
+    int free_list{null_node};
+    std::size_t free_count{0};
+    std::size_t proxy_count{0};
+    std::size_t reinsert_count{0};
+    mutable std::vector<int> stack;
+};
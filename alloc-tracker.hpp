@@ -0,0 +1,308 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <format>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+
+#include <malloc.h>
+
+// What the program was doing when memory was allocated.
+enum class AllocSite : Uint8
+{
+    Startup,
+    Init,
+    LoadMedia,
+    Simulate,
+    Render,
+    Background,
+    Shutdown,
+    Count,
+};
+
+// Who asked: SDL and its satellite libraries through SDL_malloc, or our code through operator new.
+enum class AllocSource : Uint8
+{
+    Sdl,
+    New,
+    Count,
+};
+
+inline const char *to_string(AllocSite site)
+{
+    switch (site)
+    {
+    case AllocSite::Startup:
+        return "startup";
+    case AllocSite::Init:
+        return "init";
+    case AllocSite::LoadMedia:
+        return "load_media";
+    case AllocSite::Simulate:
+        return "simulate";
+    case AllocSite::Render:
+        return "render";
+    case AllocSite::Background:
+        return "background";
+    case AllocSite::Shutdown:
+        return "shutdown";
+    case AllocSite::Count:
+        break;
+    }
+    return "unknown";
+}
+
+inline const char *to_string(AllocSource source)
+{
+    return source == AllocSource::Sdl ? "SDL_malloc" : "operator new";
+}
+
+/*
+Counts every allocation made through SDL_malloc (SDL, SDL_image, SDL_ttf and
+SDL_mixer all use it) and through operator new, by site and source.
+
+Blocks are plain malloc blocks: nothing is added around them, so memory
+allocated by one allocator and freed by the other (libstdc++ built as a DLL
+keeps its own operator new) is still freed correctly. Sizes come from the C
+runtime (_msize, malloc_usable_size), which is what lets frees be counted
+per source without a header; they are not charged back to a site. The site
+is per thread: a Scope names what the current thread is doing, and threads
+without one (job workers, the audio callback, encoders) fall under the
+process-wide phase. Libraries that call the C allocator directly, such as
+FreeType and libpng inside SDL_ttf and SDL_image, are invisible here.
+
+Between begin_steady_state() and end_steady_state() no allocation is
+expected at all: each one is counted as a violation and the first few are
+kept for the report. All state is atomics in fixed arrays, so tracking
+itself never allocates.
+*/
+class AllocTracker
+{
+public:
+    class Scope
+    {
+    public:
+        explicit Scope(AllocSite site) : previous{thread_site} { thread_site = static_cast<int>(site); }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+        ~Scope() { thread_site = this->previous; }
+
+    private:
+        int previous;
+    };
+
+    struct Violation
+    {
+        AllocSite site;
+        AllocSource source;
+        std::size_t size;
+    };
+
+    // Must run before anything calls SDL_malloc, i.e. before SDL_Init.
+    static void install_sdl()
+    {
+        if (SDL_GetNumAllocations() > 0 ||
+            SDL_SetMemoryFunctions(sdl_malloc, sdl_calloc, sdl_realloc, sdl_free))
+        {
+            auto error = std::format("Error installing tracking allocator: {}", SDL_GetError());
+            throw std::runtime_error(error);
+        }
+    }
+
+    static void set_phase(AllocSite site) { phase.store(static_cast<int>(site), std::memory_order_relaxed); }
+
+    static void begin_steady_state() { steady.store(true, std::memory_order_release); }
+    static void end_steady_state() { steady.store(false, std::memory_order_release); }
+    static std::size_t steady_allocations() { return violations.load(std::memory_order_relaxed); }
+
+    // `align` is only for the over-aligned operator new forms; 0 means malloc's. Returns nullptr when out of memory.
+    static void *allocate(AllocSource source, std::size_t size, std::size_t align = 0)
+    {
+        void *block = nullptr;
+        if (align == 0)
+        {
+            block = std::malloc(size);
+        }
+        else
+        {
+#ifdef _WIN32
+            block = _aligned_malloc(size, align);
+#else
+            block = std::aligned_alloc(align, (size + align - 1) / align * align);
+#endif
+        }
+        if (block)
+        {
+            record(current_site(), source, size, usable_size(block, align));
+        }
+        return block;
+    }
+
+    // `align` must be what the block was allocated with.
+    static void release(AllocSource source, void *block, std::size_t align = 0)
+    {
+        if (!block)
+        {
+            return;
+        }
+        forget(source, usable_size(block, align));
+#ifdef _WIN32
+        if (align != 0)
+        {
+            _aligned_free(block);
+            return;
+        }
+#endif
+        std::free(block);
+    }
+
+    static void report(std::ostream &out)
+    {
+        out << "allocations (count / MiB requested):" << std::endl;
+        for (int site = 0; site < static_cast<int>(AllocSite::Count); ++site)
+        {
+            for (int source = 0; source < static_cast<int>(AllocSource::Count); ++source)
+            {
+                const Totals &totals = table[site][source];
+                std::size_t count = totals.count.load(std::memory_order_relaxed);
+                if (count == 0)
+                {
+                    continue;
+                }
+                out << std::format("  {:<11} {:<13} {:>9} {:>9.2f}{}", to_string(static_cast<AllocSite>(site)),
+                                   to_string(static_cast<AllocSource>(source)), count,
+                                   totals.bytes.load(std::memory_order_relaxed) / 1048576.0,
+                                   totals.steady.load(std::memory_order_relaxed)
+                                       ? std::format("  {} in steady state", totals.steady.load())
+                                       : "")
+                    << std::endl;
+            }
+        }
+        for (int source = 0; source < static_cast<int>(AllocSource::Count); ++source)
+        {
+            const Usage &usage = usage_by_source[source];
+            // Signed: a block allocated by another module's allocator can be freed through ours.
+            auto live = static_cast<std::ptrdiff_t>(usage.allocated.load(std::memory_order_relaxed) -
+                                                    usage.freed.load(std::memory_order_relaxed));
+            out << std::format("  {:<13} {} frees, {:.1f} KiB live at exit",
+                               to_string(static_cast<AllocSource>(source)),
+                               usage.frees.load(std::memory_order_relaxed), live / 1024.0)
+                << std::endl;
+        }
+
+        std::size_t flagged = steady_allocations();
+        if (flagged == 0)
+        {
+            out << "steady state: no allocations" << std::endl;
+            return;
+        }
+        out << std::format("steady state: FLAGGED {} allocations; the first were:", flagged) << std::endl;
+        std::size_t kept = std::min<std::size_t>(flagged, samples.size());
+        for (std::size_t i = 0; i < kept; ++i)
+        {
+            const Violation &sample = samples[i];
+            out << std::format("  {} bytes, {} on the {} site", sample.size, to_string(sample.source),
+                               to_string(sample.site))
+                << std::endl;
+        }
+    }
+
+private:
+    struct Totals
+    {
+        std::atomic<std::size_t> count;
+        std::atomic<std::size_t> bytes;
+        std::atomic<std::size_t> steady;
+    };
+
+    // Usable bytes, which is what the C runtime reports back on free.
+    struct Usage
+    {
+        std::atomic<std::size_t> allocated;
+        std::atomic<std::size_t> freed;
+        std::atomic<std::size_t> frees;
+    };
+
+    static std::size_t usable_size(void *block, std::size_t align)
+    {
+#ifdef _WIN32
+        return align ? _aligned_msize(block, align, 0) : _msize(block);
+#else
+        (void)align;
+        return malloc_usable_size(block);
+#endif
+    }
+
+    static int current_site()
+    {
+        return thread_site >= 0 ? thread_site : phase.load(std::memory_order_relaxed);
+    }
+
+    static void record(int site, AllocSource source, std::size_t size, std::size_t usable)
+    {
+        Totals &totals = table[site][static_cast<int>(source)];
+        totals.count.fetch_add(1, std::memory_order_relaxed);
+        totals.bytes.fetch_add(size, std::memory_order_relaxed);
+        usage_by_source[static_cast<int>(source)].allocated.fetch_add(usable, std::memory_order_relaxed);
+        if (steady.load(std::memory_order_relaxed))
+        {
+            totals.steady.fetch_add(1, std::memory_order_relaxed);
+            std::size_t index = violations.fetch_add(1, std::memory_order_relaxed);
+            if (index < samples.size())
+            {
+                samples[index] = {static_cast<AllocSite>(site), source, size};
+            }
+        }
+    }
+
+    static void forget(AllocSource source, std::size_t usable)
+    {
+        Usage &usage = usage_by_source[static_cast<int>(source)];
+        usage.frees.fetch_add(1, std::memory_order_relaxed);
+        usage.freed.fetch_add(usable, std::memory_order_relaxed);
+    }
+
+    static void *SDLCALL sdl_malloc(size_t size) { return allocate(AllocSource::Sdl, size); }
+
+    static void *SDLCALL sdl_calloc(size_t count, size_t size)
+    {
+        void *block = std::calloc(count, size);
+        if (block)
+        {
+            record(current_site(), AllocSource::Sdl, count * size, usable_size(block, 0));
+        }
+        return block;
+    }
+
+    static void *SDLCALL sdl_realloc(void *block, size_t size)
+    {
+        std::size_t before = block ? usable_size(block, 0) : 0;
+        void *moved = std::realloc(block, size);
+        if (moved)
+        {
+            if (block)
+            {
+                forget(AllocSource::Sdl, before);
+            }
+            record(current_site(), AllocSource::Sdl, size, usable_size(moved, 0));
+        }
+        return moved;
+    }
+
+    static void SDLCALL sdl_free(void *block) { release(AllocSource::Sdl, block); }
+
+    // Sites are ints so -1 can mean "no Scope on this thread".
+    static inline thread_local int thread_site{-1};
+    static inline std::atomic<int> phase{static_cast<int>(AllocSite::Startup)};
+    static inline std::atomic<bool> steady{false};
+    static inline std::atomic<std::size_t> violations{0};
+    static inline std::array<Violation, 8> samples{};
+    static inline Totals table[static_cast<int>(AllocSite::Count)][static_cast<int>(AllocSource::Count)]{};
+    static inline Usage usage_by_source[static_cast<int>(AllocSource::Count)]{};
+};
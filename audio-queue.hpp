@@ -0,0 +1,260 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Single-producer/single-consumer ring buffer. Capacity must be a power of two.
+template <typename T, std::size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    bool try_push(const T &value)
+    {
+        std::size_t head = this->head.load(std::memory_order_relaxed);
+        if (head - this->tail.load(std::memory_order_acquire) == Capacity)
+        {
+            return false;
+        }
+        this->slots[head & (Capacity - 1)] = value;
+        this->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // All or nothing: the consumer sees the whole batch at once or not at all.
+    bool try_push_n(const T *values, std::size_t count)
+    {
+        std::size_t head = this->head.load(std::memory_order_relaxed);
+        if (Capacity - (head - this->tail.load(std::memory_order_acquire)) < count)
+        {
+            return false;
+        }
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            this->slots[(head + i) & (Capacity - 1)] = values[i];
+        }
+        this->head.store(head + count, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T &value)
+    {
+        std::size_t tail = this->tail.load(std::memory_order_relaxed);
+        if (tail == this->head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        value = this->slots[tail & (Capacity - 1)];
+        this->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when read from a thread that is neither producer nor consumer.
+    std::size_t size() const
+    {
+        return this->head.load(std::memory_order_acquire) - this->tail.load(std::memory_order_acquire);
+    }
+
+    static constexpr std::size_t capacity() { return Capacity; }
+
+private:
+    std::array<T, Capacity> slots{};
+    alignas(64) std::atomic<std::size_t> head{0};
+    alignas(64) std::atomic<std::size_t> tail{0};
+};
+
+struct AudioCommand
+{
+    enum class Type : Uint8
+    {
+        Play,
+        Stop,
+        Volume,
+        MusicVolume,
+        MusicPosition,
+        PlayMusic,
+        HaltMusic,
+        PlayAtVolume,
+    };
+
+    Type type;
+    int channel;
+    Mix_Chunk *chunk;
+    int value;
+    double position;
+    Mix_Music *music;
+
+    static AudioCommand play(Mix_Chunk *chunk, int channel = -1, int loops = 0)
+    {
+        return {Type::Play, channel, chunk, loops, 0.0, nullptr};
+    }
+    static AudioCommand stop(int channel = -1) { return {Type::Stop, channel, nullptr, 0, 0.0, nullptr}; }
+    static AudioCommand volume(int channel, int volume)
+    {
+        return {Type::Volume, channel, nullptr, volume, 0.0, nullptr};
+    }
+    static AudioCommand music_volume(int volume) { return {Type::MusicVolume, -1, nullptr, volume, 0.0, nullptr}; }
+    static AudioCommand music_position(double seconds)
+    {
+        return {Type::MusicPosition, -1, nullptr, 0, seconds, nullptr};
+    }
+    static AudioCommand play_music(Mix_Music *music, int loops = -1)
+    {
+        return {Type::PlayMusic, -1, nullptr, loops, 0.0, music};
+    }
+    static AudioCommand halt_music() { return {Type::HaltMusic, -1, nullptr, 0, 0.0, nullptr}; }
+    static AudioCommand play_at_volume(Mix_Chunk *chunk, int volume)
+    {
+        return {Type::PlayAtVolume, -1, chunk, volume, 0.0, nullptr};
+    }
+};
+
+/*
+Game thread -> audio callback command queue.
+
+SDL_mixer gives no hook before it mixes, so the queue is drained from the
+post-mix callback: it already runs on the audio thread with the device lock
+held, and whatever it applies takes effect from the very next buffer. The
+game thread only touches the ring buffer and never waits on the audio lock.
+*/
+class AudioCommandQueue
+{
+public:
+    struct Stats
+    {
+        std::size_t depth;
+        std::size_t max_depth;
+        Uint64 pushed;
+        Uint64 dropped;
+        Uint64 applied;
+    };
+
+    AudioCommandQueue() = default;
+    AudioCommandQueue(const AudioCommandQueue &) = delete;
+    AudioCommandQueue &operator=(const AudioCommandQueue &) = delete;
+    ~AudioCommandQueue() { this->uninstall(); }
+
+    // Call with the audio device open.
+    void install()
+    {
+        Mix_SetPostMix(&AudioCommandQueue::postmix, this);
+        this->installed = true;
+    }
+
+    void uninstall()
+    {
+        if (this->installed)
+        {
+            Mix_SetPostMix(nullptr, nullptr);
+            this->installed = false;
+        }
+    }
+
+    // Game thread only. A full queue drops the command rather than blocking.
+    bool push(const AudioCommand &command)
+    {
+        if (!this->commands.try_push(command))
+        {
+            this->dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        this->pushed.fetch_add(1, std::memory_order_relaxed);
+        std::size_t depth = this->commands.size();
+        if (depth > this->max_depth.load(std::memory_order_relaxed))
+        {
+            this->max_depth.store(depth, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // Game thread only. Publishes the commands together, or drops all of them.
+    bool push_batch(const AudioCommand *batch, std::size_t count)
+    {
+        if (!this->commands.try_push_n(batch, count))
+        {
+            this->dropped.fetch_add(count, std::memory_order_relaxed);
+            return false;
+        }
+        this->pushed.fetch_add(count, std::memory_order_relaxed);
+        std::size_t depth = this->commands.size();
+        if (depth > this->max_depth.load(std::memory_order_relaxed))
+        {
+            this->max_depth.store(depth, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // Audio thread only, or any thread while the device is locked or closed.
+    void drain()
+    {
+        AudioCommand command;
+        while (this->commands.try_pop(command))
+        {
+            apply(command);
+            this->applied.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    Stats stats() const
+    {
+        return {this->commands.size(), this->max_depth.load(std::memory_order_relaxed),
+                this->pushed.load(std::memory_order_relaxed), this->dropped.load(std::memory_order_relaxed),
+                this->applied.load(std::memory_order_relaxed)};
+    }
+
+    // Must run on the audio thread or with the device locked.
+    static void apply(const AudioCommand &command)
+    {
+        switch (command.type)
+        {
+        case AudioCommand::Type::Play:
+            Mix_PlayChannel(command.channel, command.chunk, command.value);
+            break;
+        case AudioCommand::Type::Stop:
+            Mix_HaltChannel(command.channel);
+            break;
+        case AudioCommand::Type::Volume:
+            Mix_Volume(command.channel, command.value);
+            break;
+        case AudioCommand::Type::MusicVolume:
+            Mix_VolumeMusic(command.value);
+            break;
+        case AudioCommand::Type::MusicPosition:
+            Mix_SetMusicPosition(command.position);
+            break;
+        case AudioCommand::Type::PlayMusic:
+            Mix_PlayMusic(command.music, command.value);
+            break;
+        case AudioCommand::Type::HaltMusic:
+            Mix_HaltMusic();
+            break;
+        // Leaves the channel at that volume for whatever plays on it next.
+        case AudioCommand::Type::PlayAtVolume:
+        {
+            int channel = Mix_PlayChannel(-1, command.chunk, 0);
+            if (channel >= 0)
+            {
+                Mix_Volume(channel, command.value);
+            }
+            break;
+        }
+        }
+    }
+
+private:
+    static void SDLCALL postmix(void *udata, Uint8 *, int)
+    {
+        static_cast<AudioCommandQueue *>(udata)->drain();
+    }
+
+    SpscQueue<AudioCommand, 256> commands;
+    std::atomic<std::size_t> max_depth{0};
+    std::atomic<Uint64> pushed{0};
+    std::atomic<Uint64> dropped{0};
+    std::atomic<Uint64> applied{0};
+    bool installed{false};
+};
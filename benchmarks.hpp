@@ -0,0 +1,769 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "aabb-tree.hpp"
+#include "bounce-kernel.hpp"
+#include "camera.hpp"
+#include "entity-store.hpp"
+#include "golden-image.hpp"
+#include "job-system.hpp"
+#include "object-pool.hpp"
+#include "particles.hpp"
+#include "resampler.hpp"
+#include "soft-blitter.hpp"
+#include "spatial-hash.hpp"
+
+/*
+Headless benchmarks: no window, no audio device, results on stdout.
+Run with --bench <name>, or --bench all.
+*/
+
+inline double seconds_since(Uint64 start)
+{
+    return static_cast<double>(SDL_GetPerformanceCounter() - start) /
+           static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+// Cost of producing one second of stereo output per tier and source rate.
+inline void bench_resampler()
+{
+    constexpr int dst_rate = 44100;
+    constexpr int channels = 2;
+    constexpr int seconds = 10;
+
+    for (int src_rate : {22050, 48000})
+    {
+        std::vector<float> in(static_cast<std::size_t>(src_rate) * seconds * channels);
+        for (std::size_t i = 0; i < in.size(); ++i)
+        {
+            in[i] = static_cast<float>(std::sin(static_cast<double>(i) * 0.01));
+        }
+        std::vector<float> out;
+
+        for (auto quality : {ResampleQuality::Nearest, ResampleQuality::Linear, ResampleQuality::Sinc})
+        {
+            // The first pass only warms the output buffer and caches.
+            Resampler::process(in.data(), in.size() / channels, channels, src_rate, dst_rate, quality, out);
+            Uint64 start = SDL_GetPerformanceCounter();
+            Resampler::process(in.data(), in.size() / channels, channels, src_rate, dst_rate, quality, out);
+            double per_voice_second = seconds_since(start) / seconds;
+
+            std::cout << std::format("resampler {:>7} {} -> {} Hz: {:8.1f} us per voice-second ({:.0f} voices realtime)",
+                                     to_string(quality), src_rate, dst_rate, per_voice_second * 1e6,
+                                     1.0 / per_voice_second)
+                      << std::endl;
+        }
+    }
+}
+
+// The bouncing text of Game::update_text, scaled up. Same window, same seed every run.
+inline void fill_bouncing_entities(EntityStore &entities, std::size_t count, float width, float height)
+{
+    std::mt19937 gen{1234};
+    std::uniform_real_distribution<float> x_pos{0.0f, width - 64.0f};
+    std::uniform_real_distribution<float> y_pos{0.0f, height - 32.0f};
+    std::uniform_real_distribution<float> speed{-3.0f, 3.0f};
+
+    entities.clear();
+    entities.reserve(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        entities.spawn(x_pos(gen), y_pos(gen), speed(gen), speed(gen), 64.0f, 32.0f, nullptr);
+    }
+}
+
+inline void bench_entities()
+{
+    constexpr std::size_t count = 1'000'000;
+    constexpr int frames = 200;
+    constexpr float width = 800.0f;
+    constexpr float height = 600.0f;
+
+    EntityStore entities;
+    fill_bouncing_entities(entities, count, width, height);
+
+    std::size_t bounces = 0;
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        bounces += bounce_entities(entities, width, height);
+    }
+    double per_frame = seconds_since(start) / frames;
+    std::cout << std::format("entities: {} bouncing, {:.3f} ms per frame ({} bounces)", count, per_frame * 1e3,
+                             bounces)
+              << std::endl;
+
+    // Churn: despawn and respawn a tenth of the population through stable handles.
+    std::vector<EntityHandle> handles;
+    handles.reserve(count);
+    entities.clear();
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        handles.push_back(entities.spawn(0.0f, 0.0f, 1.0f, 1.0f, 64.0f, 32.0f, nullptr));
+    }
+    start = SDL_GetPerformanceCounter();
+    for (std::size_t i = 0; i < count; i += 10)
+    {
+        entities.despawn(handles[i]);
+        handles[i] = entities.spawn(0.0f, 0.0f, 1.0f, 1.0f, 64.0f, 32.0f, nullptr);
+    }
+    double churn = seconds_since(start);
+    std::cout << std::format("entities: {} despawn+spawn pairs in {:.3f} ms ({:.1f} ns each)", count / 10,
+                             churn * 1e3, churn * 1e9 / (count / 10))
+              << std::endl;
+}
+
+// Scalar vs SIMD bounce kernels, in and out of cache.
+inline void bench_bounce()
+{
+    constexpr float width = 800.0f;
+    constexpr float height = 600.0f;
+
+    for (std::size_t count : {std::size_t{16'384}, std::size_t{1'000'000}})
+    {
+        int frames = static_cast<int>(200'000'000 / count);
+        std::size_t reference = 0;
+        for (auto kernel : {BounceKernel::Scalar, BounceKernel::SSE2, BounceKernel::AVX2})
+        {
+            if (!bounce_kernel_available(kernel))
+            {
+                std::cout << std::format("bounce {:>6}: not supported on this CPU", to_string(kernel)) << std::endl;
+                continue;
+            }
+
+            EntityStore entities;
+            fill_bouncing_entities(entities, count, width, height);
+            std::size_t bounces = 0;
+            Uint64 start = SDL_GetPerformanceCounter();
+            for (int frame = 0; frame < frames; ++frame)
+            {
+                bounces += bounce_entities(entities, 0, count, width, height, kernel);
+            }
+            double seconds = seconds_since(start);
+            if (kernel == BounceKernel::Scalar)
+            {
+                reference = bounces;
+            }
+
+            std::cout << std::format("bounce {:>6}: {:>7} entities, {:.3f} ms per frame, {:.2f} entities/ns{}",
+                                     to_string(kernel), count, seconds * 1e3 / frames,
+                                     static_cast<double>(count) * frames / (seconds * 1e9),
+                                     bounces == reference ? "" : " (MISMATCH vs scalar)")
+                      << std::endl;
+        }
+    }
+}
+
+// Bounce update split across 1..N threads by the job system.
+inline void bench_jobs()
+{
+    constexpr std::size_t count = 1'000'000;
+    constexpr std::size_t grain = 16'384;
+    constexpr int frames = 200;
+    constexpr float width = 800.0f;
+    constexpr float height = 600.0f;
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    BounceKernel kernel = best_bounce_kernel();
+    EntityStore entities;
+    double single = 0.0;
+
+    for (unsigned threads = 1; threads <= cores; ++threads)
+    {
+        fill_bouncing_entities(entities, count, width, height);
+        JobSystem jobs{threads - 1};
+        std::atomic<std::size_t> bounces{0};
+        auto update = [&](std::size_t begin, std::size_t end)
+        {
+            bounces.fetch_add(bounce_entities(entities, begin, end, width, height, kernel), std::memory_order_relaxed);
+        };
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            jobs.parallel_for(0, count, grain, update);
+        }
+        double per_frame = seconds_since(start) / frames;
+        if (threads == 1)
+        {
+            single = per_frame;
+        }
+
+        std::cout << std::format("jobs: {:>2} threads, {} entities ({}), {:.3f} ms per frame, {:.2f}x, {} steals",
+                                 threads, count, to_string(kernel), per_frame * 1e3, single / per_frame,
+                                 jobs.steal_count())
+                  << std::endl;
+    }
+}
+
+// Broad-phase build and pair time for a sparse world, checked against brute force on a subset.
+inline void bench_spatial()
+{
+    constexpr float world = 8192.0f;
+    std::mt19937 gen{99};
+    std::uniform_real_distribution<float> pos{0.0f, world};
+    std::uniform_real_distribution<float> size{4.0f, 24.0f};
+
+    for (std::size_t count : {std::size_t{2'000}, std::size_t{50'000}})
+    {
+        EntityStore entities;
+        entities.reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            entities.spawn(pos(gen), pos(gen), 0.0f, 0.0f, size(gen), size(gen), nullptr);
+        }
+
+        SpatialHash grid{32.0f};
+        constexpr int frames = 20;
+        double build_ms = 0.0;
+        double pair_ms = 0.0;
+        std::size_t pairs = 0;
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            grid.build(entities);
+            build_ms += grid.stats().build_ms;
+            Uint64 start = SDL_GetPerformanceCounter();
+            pairs = grid.for_each_pair([](Uint32, Uint32) {});
+            pair_ms += seconds_since(start) * 1e3;
+        }
+
+        std::string check;
+        if (count <= 2'000)
+        {
+            std::size_t brute = 0;
+            const float *x = entities.x(), *y = entities.y(), *w = entities.w(), *h = entities.h();
+            Uint64 start = SDL_GetPerformanceCounter();
+            for (std::size_t a = 0; a < count; ++a)
+            {
+                for (std::size_t b = a + 1; b < count; ++b)
+                {
+                    brute += x[a] < x[b] + w[b] && x[b] < x[a] + w[a] && y[a] < y[b] + h[b] && y[b] < y[a] + h[a];
+                }
+            }
+            check = std::format(", brute force {} pairs in {:.3f} ms", brute, seconds_since(start) * 1e3);
+        }
+
+        std::cout << std::format("spatial: {} boxes, {} entries, build {:.3f} ms, pairs {:.3f} ms, {} pairs{}",
+                                 count, grid.stats().entries, build_ms / frames, pair_ms / frames, pairs, check)
+                  << std::endl;
+    }
+}
+
+// View culling and raycasts through the AABB tree over a world much larger than the window,
+// checked against a linear scan.
+inline void bench_aabb_tree()
+{
+    constexpr float world = 8192.0f;
+    constexpr std::size_t count = 20'000;
+    constexpr int frames = 100;
+    EntityStore entities;
+    fill_bouncing_entities(entities, count, world, world);
+
+    AabbTree tree;
+    std::vector<int> proxies(count);
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        proxies[i] = tree.create(Aabb::from_rect(entities.rect(i)), static_cast<Uint32>(i));
+    }
+    double build_ms = seconds_since(start) * 1e3;
+
+    const Aabb view{world / 2, world / 2, world / 2 + 800.0f, world / 2 + 600.0f};
+    double move_ms = 0.0;
+    double query_ms = 0.0;
+    double scan_ms = 0.0;
+    std::size_t visible = 0;
+    std::size_t mismatches = 0;
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        bounce_entities(entities, world, world);
+
+        start = SDL_GetPerformanceCounter();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            tree.move(proxies[i], Aabb::from_rect(entities.rect(i)), entities.xvel()[i], entities.yvel()[i]);
+        }
+        move_ms += seconds_since(start) * 1e3;
+
+        start = SDL_GetPerformanceCounter();
+        visible = 0;
+        tree.query(view, [&](Uint32 i) { visible += Aabb::from_rect(entities.rect(i)).overlaps(view); });
+        query_ms += seconds_since(start) * 1e3;
+
+        start = SDL_GetPerformanceCounter();
+        std::size_t scanned = 0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            scanned += Aabb::from_rect(entities.rect(i)).overlaps(view);
+        }
+        scan_ms += seconds_since(start) * 1e3;
+        mismatches += scanned != visible;
+    }
+
+    std::mt19937 gen{7};
+    std::uniform_real_distribution<float> pos{0.0f, world};
+    constexpr int rays = 1000;
+    double ray_ms = 0.0;
+    for (int r = 0; r < rays; ++r)
+    {
+        float x0 = pos(gen), y0 = pos(gen), x1 = pos(gen), y1 = pos(gen);
+        float dx = x1 - x0, dy = y1 - y0;
+
+        start = SDL_GetPerformanceCounter();
+        float nearest = 2.0f;
+        tree.raycast(x0, y0, x1, y1,
+                     [&](Uint32 i, float max_fraction)
+                     {
+                         float t = AabbTree::segment_entry(Aabb::from_rect(entities.rect(i)), x0, y0, dx, dy,
+                                                           max_fraction);
+                         if (t > max_fraction)
+                         {
+                             return max_fraction;
+                         }
+                         nearest = t;
+                         return t;
+                     });
+        ray_ms += seconds_since(start) * 1e3;
+
+        float brute = 2.0f;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            brute = std::min(brute, AabbTree::segment_entry(Aabb::from_rect(entities.rect(i)), x0, y0, dx, dy, 1.0f));
+        }
+        mismatches += (brute <= 1.0f ? brute : 2.0f) != nearest;
+    }
+
+    auto stats = tree.stats();
+    std::cout << std::format("aabb tree: {} boxes, height {}, build {:.2f} ms, {:.1f} reinserts/frame",
+                             count, stats.height, build_ms, static_cast<double>(stats.reinserts) / frames)
+              << std::endl;
+    std::cout << std::format("aabb tree: move {:.3f} ms, cull {:.4f} ms ({} visible) vs scan {:.4f} ms, "
+                             "raycast {:.2f} us, {} mismatches",
+                             move_ms / frames, query_ms / frames, visible, scan_ms / frames, ray_ms * 1e3 / rays,
+                             mismatches)
+              << std::endl;
+}
+
+// 100k spawns per second at 60 fps, each object living about a second: pool versus new/delete.
+inline void bench_pool()
+{
+    struct Shot
+    {
+        float x, y, xvel, yvel;
+        int ttl;
+    };
+    constexpr int frames = 600;
+    constexpr int warm_up = 120;
+    constexpr int spawns_per_frame = 100'000 / 60;
+
+    ObjectPool<Shot> pool{4096, ObjectPool<Shot>::Growth::Growable};
+    std::vector<PoolHandle> handles;
+    handles.reserve(200'000);
+    std::size_t warm_blocks = 0;
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        if (frame == warm_up)
+        {
+            warm_blocks = pool.stats().blocks;
+        }
+        pool.for_each(
+            [&](PoolHandle handle, Shot &shot)
+            {
+                shot.x += shot.xvel;
+                shot.y += shot.yvel;
+                if (--shot.ttl <= 0)
+                {
+                    pool.destroy(handle);
+                }
+            });
+        for (int i = 0; i < spawns_per_frame; ++i)
+        {
+            handles.push_back(pool.create(Shot{0.0f, 0.0f, 1.0f, 1.0f, 50 + i % 20}));
+            if (handles.size() == handles.capacity())
+            {
+                handles.clear();
+            }
+        }
+    }
+    double pool_ms = seconds_since(start) * 1e3 / frames;
+
+    std::size_t stale = 0;
+    for (PoolHandle handle : handles)
+    {
+        stale += pool.get(handle) == nullptr;
+    }
+
+    std::vector<std::unique_ptr<Shot>> heap;
+    start = SDL_GetPerformanceCounter();
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        for (std::size_t i = 0; i < heap.size();)
+        {
+            Shot &shot = *heap[i];
+            shot.x += shot.xvel;
+            shot.y += shot.yvel;
+            if (--shot.ttl <= 0)
+            {
+                heap[i] = std::move(heap.back());
+                heap.pop_back();
+                continue;
+            }
+            ++i;
+        }
+        for (int i = 0; i < spawns_per_frame; ++i)
+        {
+            heap.push_back(std::make_unique<Shot>(Shot{0.0f, 0.0f, 1.0f, 1.0f, 50 + i % 20}));
+        }
+    }
+    double heap_ms = seconds_since(start) * 1e3 / frames;
+
+    auto stats = pool.stats();
+    std::cout << std::format("pool: {} spawns/frame, {} live (peak {}), capacity {} in {} blocks, "
+                             "{} blocks added after warm-up, {} stale handles caught",
+                             spawns_per_frame, stats.live, stats.peak, stats.capacity, stats.blocks,
+                             stats.blocks - warm_blocks, stale)
+              << std::endl;
+    std::cout << std::format("pool: {:.3f} ms/frame vs new/delete {:.3f} ms/frame", pool_ms, heap_ms) << std::endl;
+}
+
+// A fountain held at ~200k live particles: update and vertex build per 60 Hz tick.
+inline void bench_particles()
+{
+    ParticleSystem particles{1234, 300.0f};
+    int fountain = particles.add_emitter({80'000.0f, 2.0f, 3.0f, 200.0f, 400.0f, -1.5708f, 0.4f,
+                                          {{0.0f, {255, 255, 160, 255}}, {1.0f, {255, 64, 0, 0}}},
+                                          {{0.0f, 3.0f}, {1.0f, 1.0f}}});
+    particles.move_emitter(fountain, 400.0f, 600.0f);
+    particles.set_active(fountain, true);
+    particles.reserve(250'000);
+
+    constexpr float dt = 1.0f / 60.0f;
+    for (int tick = 0; tick < 180; ++tick)
+    {
+        particles.update(dt);
+    }
+
+    constexpr int ticks = 120;
+    JobSystem jobs;
+    double update_ms = 0.0;
+    double build_ms = 0.0;
+    double parallel_build_ms = 0.0;
+    ParticleGeometry geometry;
+    std::size_t live = 0;
+    for (int tick = 0; tick < ticks; ++tick)
+    {
+        Uint64 start = SDL_GetPerformanceCounter();
+        particles.update(dt);
+        update_ms += seconds_since(start) * 1e3;
+        live += particles.size();
+
+        geometry.resize(particles.size());
+        start = SDL_GetPerformanceCounter();
+        geometry.build(particles, 0, particles.size());
+        build_ms += seconds_since(start) * 1e3;
+
+        start = SDL_GetPerformanceCounter();
+        jobs.parallel_for(0, particles.size(), 16384,
+                          [&](std::size_t begin, std::size_t end) { geometry.build(particles, begin, end); });
+        parallel_build_ms += seconds_since(start) * 1e3;
+    }
+
+    std::cout << std::format("particles: {} live, update {:.3f} ms, vertices {:.3f} ms ({:.3f} ms on {} threads)",
+                             live / ticks, update_ms / ticks, build_ms / ticks, parallel_build_ms / ticks,
+                             jobs.thread_count())
+              << std::endl;
+}
+
+// Megapixels blended per second: SoftCompositor per kernel, then SDL's software renderer on the same frame.
+inline void bench_blit()
+{
+    constexpr int width = 1280;
+    constexpr int height = 720;
+    constexpr int sprite_size = 64;
+    constexpr int count = 4000;
+    constexpr int frames = 20;
+
+    SurfacePtr target{SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888),
+                      SDL_FreeSurface};
+    SurfacePtr sprite{SDL_CreateRGBSurfaceWithFormat(0, sprite_size, sprite_size, 32, SDL_PIXELFORMAT_ARGB8888),
+                      SDL_FreeSurface};
+    if (!target || !sprite)
+    {
+        auto error = std::format("Error creating Surface: {}", SDL_GetError());
+        throw std::runtime_error(error);
+    }
+    // A soft disc: opaque centre, transparent corners, every alpha in between.
+    for (int y = 0; y < sprite_size; ++y)
+    {
+        auto *row = reinterpret_cast<Uint32 *>(static_cast<Uint8 *>(sprite->pixels) + y * sprite->pitch);
+        for (int x = 0; x < sprite_size; ++x)
+        {
+            float dx = x - sprite_size / 2.0f, dy = y - sprite_size / 2.0f;
+            float edge = 1.0f - std::sqrt(dx * dx + dy * dy) / (sprite_size / 2.0f);
+            Uint32 alpha = static_cast<Uint32>(std::clamp(edge * 2.0f, 0.0f, 1.0f) * 255.0f);
+            row[x] = alpha << 24 | static_cast<Uint32>(x * 4) << 16 | static_cast<Uint32>(y * 4) << 8 | 0x80;
+        }
+    }
+    SurfacePtr premultiplied = premultiplied_copy(sprite.get());
+
+    std::mt19937 gen{7};
+    std::uniform_int_distribution<int> xs{0, width - sprite_size};
+    std::uniform_int_distribution<int> ys{0, height - sprite_size};
+    std::vector<SDL_Point> positions(count);
+    for (SDL_Point &p : positions)
+    {
+        p = {xs(gen), ys(gen)};
+    }
+
+    auto clear = [&] { SDL_FillRect(target.get(), nullptr, 0xff203040); };
+    auto frame_bytes = [&]
+    {
+        const auto *pixels = static_cast<const Uint8 *>(target->pixels);
+        return std::vector<Uint8>(pixels, pixels + static_cast<std::size_t>(target->pitch) * height);
+    };
+
+    JobSystem jobs;
+    SoftCompositor compositor{jobs};
+    std::vector<Uint8> reference;
+    double pixels = static_cast<double>(count) * sprite_size * sprite_size;
+    for (auto kernel : {BlendKernel::Scalar, BlendKernel::SSE2, BlendKernel::AVX2})
+    {
+        if (!blend_kernel_available(kernel))
+        {
+            continue;
+        }
+        double seconds = 0.0;
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            clear();
+            Uint64 start = SDL_GetPerformanceCounter();
+            for (const SDL_Point &p : positions)
+            {
+                compositor.add(premultiplied.get(), p.x, p.y);
+            }
+            compositor.flush(target->pixels, target->pitch, width, height, kernel);
+            seconds += seconds_since(start);
+        }
+
+        // Every kernel must match the scalar one byte for byte.
+        std::vector<Uint8> result = frame_bytes();
+        if (reference.empty())
+        {
+            reference = result;
+        }
+        std::size_t mismatched = 0;
+        for (std::size_t i = 0; i < result.size(); ++i)
+        {
+            mismatched += result[i] != reference[i];
+        }
+        std::cout << std::format("blit {:>6}: {:8.1f} MP/s on {} threads, {} tiles touched, {} bytes differ from scalar",
+                                 to_string(kernel), pixels * frames / seconds / 1e6, jobs.thread_count(),
+                                 compositor.stats().tiles_touched, mismatched)
+                  << std::endl;
+    }
+
+    std::unique_ptr<SDL_Renderer, decltype(&SDL_DestroyRenderer)> renderer{
+        SDL_CreateSoftwareRenderer(target.get()), SDL_DestroyRenderer};
+    std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)> texture{
+        renderer ? SDL_CreateTextureFromSurface(renderer.get(), sprite.get()) : nullptr, SDL_DestroyTexture};
+    if (!texture)
+    {
+        std::cout << std::format("blit    sdl: unavailable: {}", SDL_GetError()) << std::endl;
+        return;
+    }
+    SDL_SetTextureBlendMode(texture.get(), SDL_BLENDMODE_BLEND);
+    double seconds = 0.0;
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        clear();
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (const SDL_Point &p : positions)
+        {
+            SDL_Rect dst{p.x, p.y, sprite_size, sprite_size};
+            SDL_RenderCopy(renderer.get(), texture.get(), nullptr, &dst);
+        }
+        SDL_RenderFlush(renderer.get());
+        seconds += seconds_since(start);
+    }
+    std::cout << std::format("blit    sdl: {:8.1f} MP/s, SDL_RenderCopy on the software renderer",
+                             pixels * frames / seconds / 1e6)
+              << std::endl;
+}
+
+// Golden-image comparison speed per kernel; every kernel must find the same differences.
+inline void bench_diff()
+{
+    constexpr int width = 1280;
+    constexpr int height = 720;
+    constexpr int frames = 50;
+
+    SurfacePtr a{SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGB888), SDL_FreeSurface};
+    SurfacePtr b{SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGB888), SDL_FreeSurface};
+    if (!a || !b)
+    {
+        auto error = std::format("Error creating Surface: {}", SDL_GetError());
+        throw std::runtime_error(error);
+    }
+    std::mt19937 gen{11};
+    std::uniform_int_distribution<Uint32> pixel;
+    std::uniform_int_distribution<int> noise{-4, 4};
+    for (int y = 0; y < height; ++y)
+    {
+        auto *row_a = const_cast<Uint32 *>(surface_row(a.get(), y));
+        auto *row_b = const_cast<Uint32 *>(surface_row(b.get(), y));
+        for (int x = 0; x < width; ++x)
+        {
+            row_a[x] = pixel(gen);
+            // One pixel in 64 is nudged by up to 4 per channel; the top byte differs everywhere.
+            Uint32 channel = static_cast<Uint32>(std::clamp(static_cast<int>(row_a[x] & 0xff) + noise(gen), 0, 255));
+            row_b[x] = (gen() % 64 ? row_a[x] : (row_a[x] & 0xffffff00) | channel) ^ 0xff000000;
+        }
+    }
+
+    for (auto kernel : {BlendKernel::Scalar, BlendKernel::SSE2, BlendKernel::AVX2})
+    {
+        if (!blend_kernel_available(kernel))
+        {
+            continue;
+        }
+        ImageDiff diff{};
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            diff = diff_images(a.get(), b.get(), 2, kernel);
+        }
+        double seconds = seconds_since(start);
+        std::cout << std::format("diff {:>6}: {:8.1f} MP/s, {} of {} pixels over tolerance 2, max delta {}",
+                                 to_string(kernel), static_cast<double>(diff.pixels) * frames / seconds / 1e6,
+                                 diff.differing, diff.pixels, diff.max_delta)
+                  << std::endl;
+    }
+}
+
+// Screen-space jitter of a fixed object while the camera pans at 0.37 px per frame, far from the origin.
+inline void bench_camera()
+{
+    constexpr int frames = 600;
+    constexpr double pan = 0.37;
+
+    for (double base : {1e3, 1e5, 1e6, 1e7})
+    {
+        const double object = base + 100.25;
+        float last_float = 0.0f, last_double = 0.0f;
+        double jitter_float = 0.0, jitter_double = 0.0;
+        Camera camera{{0.0f, 0.0f, 1280.0f, 720.0f}};
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            double centre = base + pan * frame;
+
+            // Everything in float, as if the camera were an SDL_FPoint.
+            float screen_float = static_cast<float>(object) - static_cast<float>(centre);
+            camera.look_at(centre, 0.0);
+            float screen_double = camera.to_screen(object, 0.0).x;
+
+            // The object moves exactly -pan per frame on screen; anything else is jitter.
+            if (frame > 0)
+            {
+                jitter_float = std::max(jitter_float, std::abs(screen_float - last_float + pan));
+                jitter_double = std::max(jitter_double, std::abs(screen_double - last_double + pan));
+            }
+            last_float = screen_float;
+            last_double = screen_double;
+        }
+        std::cout << std::format("camera at x = {:>10.0f}: float {:8.4f} px, Camera {:8.4f} px worst step error",
+                                 base, jitter_float, jitter_double)
+                  << std::endl;
+    }
+}
+
+inline void run_benchmarks(std::string_view name)
+{
+    bool all = name == "all";
+    bool ran = false;
+
+    if (all || name == "resampler")
+    {
+        bench_resampler();
+        ran = true;
+    }
+
+    if (all || name == "entities")
+    {
+        bench_entities();
+        ran = true;
+    }
+
+    if (all || name == "bounce")
+    {
+        bench_bounce();
+        ran = true;
+    }
+
+    if (all || name == "jobs")
+    {
+        bench_jobs();
+        ran = true;
+    }
+
+    if (all || name == "spatial")
+    {
+        bench_spatial();
+        ran = true;
+    }
+
+    if (all || name == "aabb")
+    {
+        bench_aabb_tree();
+        ran = true;
+    }
+
+    if (all || name == "pool")
+    {
+        bench_pool();
+        ran = true;
+    }
+
+    if (all || name == "particles")
+    {
+        bench_particles();
+        ran = true;
+    }
+
+    if (all || name == "blit")
+    {
+        bench_blit();
+        ran = true;
+    }
+
+    if (all || name == "diff")
+    {
+        bench_diff();
+        ran = true;
+    }
+
+    if (all || name == "camera")
+    {
+        bench_camera();
+        ran = true;
+    }
+
+    if (!ran)
+    {
+        auto error = std::format("Unknown benchmark: {}", name);
+        throw std::runtime_error(error);
+    }
+}
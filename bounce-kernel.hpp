@@ -0,0 +1,196 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <cstddef>
+
+#include "entity-store.hpp"
+
+// SSE2 is part of the x86-64 baseline; AVX2 is compiled per function and checked at runtime.
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define BOUNCE_KERNEL_X86 1
+#if defined(__GNUC__) || defined(__clang__)
+#define BOUNCE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define BOUNCE_TARGET_AVX2
+#endif
+#endif
+
+/*
+SIMD versions of bounce_entities. Each lane integrates one entity and picks
+its new velocity with compare masks instead of branches:
+
+    v' = px < 0        ?  |v|
+       : px + w > edge ? -|v|
+       :                  v
+
+Reflections are counted by subtracting the all-ones "velocity changed"
+masks from per-lane integer counters, summed once at the end. The widest
+kernel the CPU supports is picked at runtime; leftovers go through the
+scalar loop.
+*/
+enum class BounceKernel
+{
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+inline const char *to_string(BounceKernel kernel)
+{
+    switch (kernel)
+    {
+    case BounceKernel::Scalar:
+        return "scalar";
+    case BounceKernel::SSE2:
+        return "sse2";
+    case BounceKernel::AVX2:
+        return "avx2";
+    }
+    return "unknown";
+}
+
+inline bool bounce_kernel_available(BounceKernel kernel)
+{
+    switch (kernel)
+    {
+    case BounceKernel::Scalar:
+        return true;
+#ifdef BOUNCE_KERNEL_X86
+    case BounceKernel::SSE2:
+        return SDL_HasSSE2();
+    case BounceKernel::AVX2:
+        return SDL_HasAVX2();
+#else
+    default:
+        return false;
+#endif
+    }
+    return false;
+}
+
+inline BounceKernel best_bounce_kernel()
+{
+    static const BounceKernel best = bounce_kernel_available(BounceKernel::AVX2)   ? BounceKernel::AVX2
+                                     : bounce_kernel_available(BounceKernel::SSE2) ? BounceKernel::SSE2
+                                                                                   : BounceKernel::Scalar;
+    return best;
+}
+
+#ifdef BOUNCE_KERNEL_X86
+inline std::size_t bounce_entities_sse2(EntityStore &entities, std::size_t begin, std::size_t end, float width,
+                                        float height)
+{
+    float *x = entities.x();
+    float *y = entities.y();
+    float *xvel = entities.xvel();
+    float *yvel = entities.yvel();
+    const float *w = entities.w();
+    const float *h = entities.h();
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 edge_x = _mm_set1_ps(width);
+    const __m128 edge_y = _mm_set1_ps(height);
+    __m128i counts = _mm_setzero_si128();
+    std::size_t i = begin;
+
+    auto reflect = [&](__m128 p, __m128 size, __m128 v, __m128 edge)
+    {
+        __m128 speed = _mm_andnot_ps(sign, v);
+        __m128 low = _mm_cmplt_ps(p, zero);
+        __m128 high = _mm_cmpgt_ps(_mm_add_ps(p, size), edge);
+        __m128 out = _mm_or_ps(_mm_and_ps(high, _mm_xor_ps(speed, sign)), _mm_andnot_ps(high, v));
+        return _mm_or_ps(_mm_and_ps(low, speed), _mm_andnot_ps(low, out));
+    };
+
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 vx = _mm_loadu_ps(xvel + i);
+        __m128 vy = _mm_loadu_ps(yvel + i);
+        __m128 px = _mm_add_ps(_mm_loadu_ps(x + i), vx);
+        __m128 py = _mm_add_ps(_mm_loadu_ps(y + i), vy);
+        __m128 nvx = reflect(px, _mm_loadu_ps(w + i), vx, edge_x);
+        __m128 nvy = reflect(py, _mm_loadu_ps(h + i), vy, edge_y);
+
+        counts = _mm_sub_epi32(counts, _mm_castps_si128(_mm_cmpneq_ps(nvx, vx)));
+        counts = _mm_sub_epi32(counts, _mm_castps_si128(_mm_cmpneq_ps(nvy, vy)));
+        _mm_storeu_ps(x + i, px);
+        _mm_storeu_ps(y + i, py);
+        _mm_storeu_ps(xvel + i, nvx);
+        _mm_storeu_ps(yvel + i, nvy);
+    }
+
+    alignas(16) Uint32 lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes), counts);
+    std::size_t bounces = std::size_t{lanes[0]} + lanes[1] + lanes[2] + lanes[3];
+    return bounces + bounce_entities(entities, i, end, width, height);
+}
+
+BOUNCE_TARGET_AVX2 inline std::size_t bounce_entities_avx2(EntityStore &entities, std::size_t begin,
+                                                           std::size_t end, float width, float height)
+{
+    float *x = entities.x();
+    float *y = entities.y();
+    float *xvel = entities.xvel();
+    float *yvel = entities.yvel();
+    const float *w = entities.w();
+    const float *h = entities.h();
+
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256 edge_x = _mm256_set1_ps(width);
+    const __m256 edge_y = _mm256_set1_ps(height);
+    __m256i counts = _mm256_setzero_si256();
+    std::size_t i = begin;
+
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 vx = _mm256_loadu_ps(xvel + i);
+        __m256 vy = _mm256_loadu_ps(yvel + i);
+        __m256 px = _mm256_add_ps(_mm256_loadu_ps(x + i), vx);
+        __m256 py = _mm256_add_ps(_mm256_loadu_ps(y + i), vy);
+
+        __m256 speed_x = _mm256_andnot_ps(sign, vx);
+        __m256 speed_y = _mm256_andnot_ps(sign, vy);
+        __m256 nvx = _mm256_blendv_ps(vx, _mm256_xor_ps(speed_x, sign),
+                                      _mm256_cmp_ps(_mm256_add_ps(px, _mm256_loadu_ps(w + i)), edge_x, _CMP_GT_OQ));
+        nvx = _mm256_blendv_ps(nvx, speed_x, _mm256_cmp_ps(px, zero, _CMP_LT_OQ));
+        __m256 nvy = _mm256_blendv_ps(vy, _mm256_xor_ps(speed_y, sign),
+                                      _mm256_cmp_ps(_mm256_add_ps(py, _mm256_loadu_ps(h + i)), edge_y, _CMP_GT_OQ));
+        nvy = _mm256_blendv_ps(nvy, speed_y, _mm256_cmp_ps(py, zero, _CMP_LT_OQ));
+
+        counts = _mm256_sub_epi32(counts, _mm256_castps_si256(_mm256_cmp_ps(nvx, vx, _CMP_NEQ_UQ)));
+        counts = _mm256_sub_epi32(counts, _mm256_castps_si256(_mm256_cmp_ps(nvy, vy, _CMP_NEQ_UQ)));
+        _mm256_storeu_ps(x + i, px);
+        _mm256_storeu_ps(y + i, py);
+        _mm256_storeu_ps(xvel + i, nvx);
+        _mm256_storeu_ps(yvel + i, nvy);
+    }
+
+    alignas(32) Uint32 lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), counts);
+    std::size_t bounces = 0;
+    for (Uint32 lane : lanes)
+    {
+        bounces += lane;
+    }
+    return bounces + bounce_entities(entities, i, end, width, height);
+}
+#endif
+
+inline std::size_t bounce_entities(EntityStore &entities, std::size_t begin, std::size_t end, float width,
+                                   float height, BounceKernel kernel)
+{
+    switch (kernel)
+    {
+#ifdef BOUNCE_KERNEL_X86
+    case BounceKernel::AVX2:
+        return bounce_entities_avx2(entities, begin, end, width, height);
+    case BounceKernel::SSE2:
+        return bounce_entities_sse2(entities, begin, end, width, height);
+#endif
+    default:
+        return bounce_entities(entities, begin, end, width, height);
+    }
+}
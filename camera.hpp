@@ -0,0 +1,80 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cmath>
+
+#include "aabb-tree.hpp"
+
+/*
+2D camera: world space in, screen space out.
+
+The camera keeps the world position of its view centre in doubles, which
+are exact to well under a pixel far beyond any world we have. Screen
+coordinates are computed as (world - centre) in double before anything is
+narrowed to float, so scrolling stays smooth at millions of pixels: a float
+centre at x = 4,000,000 can only move in steps of 0.25 px, and objects
+would visibly jitter against it. Zoom scales about the view centre;
+`viewport` is where the view lands on screen.
+*/
+class Camera
+{
+public:
+    static constexpr float min_zoom = 0.25f;
+    static constexpr float max_zoom = 4.0f;
+
+    explicit Camera(SDL_FRect viewport = {0.0f, 0.0f, 0.0f, 0.0f}) : viewport{viewport} {}
+
+    double centre_x() const { return this->x; }
+    double centre_y() const { return this->y; }
+    float zoom() const { return this->scale; }
+    const SDL_FRect &screen() const { return this->viewport; }
+
+    void look_at(double x, double y)
+    {
+        this->x = x;
+        this->y = y;
+    }
+
+    // Moves a fraction of the way towards the target each call; 1 snaps to it.
+    void follow(double x, double y, double stiffness)
+    {
+        this->x += (x - this->x) * stiffness;
+        this->y += (y - this->y) * stiffness;
+    }
+
+    void zoom_by(float factor) { this->scale = std::clamp(this->scale * factor, min_zoom, max_zoom); }
+
+    // World-space rectangle the camera sees.
+    Aabb view() const
+    {
+        double half_w = this->viewport.w * 0.5 / this->scale;
+        double half_h = this->viewport.h * 0.5 / this->scale;
+        return {static_cast<float>(this->x - half_w), static_cast<float>(this->y - half_h),
+                static_cast<float>(this->x + half_w), static_cast<float>(this->y + half_h)};
+    }
+
+    SDL_FPoint to_screen(double world_x, double world_y) const
+    {
+        return {static_cast<float>((world_x - this->x) * this->scale + this->viewport.x + this->viewport.w * 0.5),
+                static_cast<float>((world_y - this->y) * this->scale + this->viewport.y + this->viewport.h * 0.5)};
+    }
+
+    SDL_FRect to_screen(const SDL_FRect &world) const
+    {
+        SDL_FPoint corner = this->to_screen(world.x, world.y);
+        return {corner.x, corner.y, world.w * this->scale, world.h * this->scale};
+    }
+
+    SDL_FPoint to_world(float screen_x, float screen_y) const
+    {
+        return {static_cast<float>(this->x + (screen_x - this->viewport.x - this->viewport.w * 0.5) / this->scale),
+                static_cast<float>(this->y + (screen_y - this->viewport.y - this->viewport.h * 0.5) / this->scale)};
+    }
+
+private:
+    SDL_FRect viewport;
+    double x{0.0};
+    double y{0.0};
+    float scale{1.0f};
+};
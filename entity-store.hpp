@@ -0,0 +1,203 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+struct EntityHandle
+{
+    Uint32 slot;
+    Uint32 generation;
+};
+
+/*
+Structure-of-arrays store for simple moving objects.
+
+Each field lives in its own contiguous array indexed by a dense index, so an
+update over n entities walks a handful of linear streams. Handles point at a
+slot that records the current dense index and a generation; despawn moves the
+last entity into the hole and bumps the generation so stale handles fail.
+*/
+class EntityStore
+{
+public:
+    void reserve(std::size_t capacity)
+    {
+        this->xs.reserve(capacity);
+        this->ys.reserve(capacity);
+        this->xvels.reserve(capacity);
+        this->yvels.reserve(capacity);
+        this->ws.reserve(capacity);
+        this->hs.reserve(capacity);
+        this->textures.reserve(capacity);
+        this->owners.reserve(capacity);
+        this->slots.reserve(capacity);
+    }
+
+    EntityHandle spawn(float x, float y, float xvel, float yvel, float w, float h, SDL_Texture *texture)
+    {
+        Uint32 slot;
+        if (!this->free_slots.empty())
+        {
+            slot = this->free_slots.back();
+            this->free_slots.pop_back();
+        }
+        else
+        {
+            slot = static_cast<Uint32>(this->slots.size());
+            this->slots.push_back({0, 0});
+        }
+
+        this->slots[slot].dense = static_cast<Uint32>(this->xs.size());
+        this->xs.push_back(x);
+        this->ys.push_back(y);
+        this->xvels.push_back(xvel);
+        this->yvels.push_back(yvel);
+        this->ws.push_back(w);
+        this->hs.push_back(h);
+        this->textures.push_back(texture);
+        this->owners.push_back(slot);
+        return {slot, this->slots[slot].generation};
+    }
+
+    bool despawn(EntityHandle handle)
+    {
+        if (!this->alive(handle))
+        {
+            return false;
+        }
+
+        Uint32 hole = this->slots[handle.slot].dense;
+        Uint32 last = static_cast<Uint32>(this->xs.size() - 1);
+        if (hole != last)
+        {
+            this->xs[hole] = this->xs[last];
+            this->ys[hole] = this->ys[last];
+            this->xvels[hole] = this->xvels[last];
+            this->yvels[hole] = this->yvels[last];
+            this->ws[hole] = this->ws[last];
+            this->hs[hole] = this->hs[last];
+            this->textures[hole] = this->textures[last];
+            this->owners[hole] = this->owners[last];
+            this->slots[this->owners[hole]].dense = hole;
+        }
+        this->xs.pop_back();
+        this->ys.pop_back();
+        this->xvels.pop_back();
+        this->yvels.pop_back();
+        this->ws.pop_back();
+        this->hs.pop_back();
+        this->textures.pop_back();
+        this->owners.pop_back();
+
+        ++this->slots[handle.slot].generation;
+        this->free_slots.push_back(handle.slot);
+        return true;
+    }
+
+    bool alive(EntityHandle handle) const
+    {
+        return handle.slot < this->slots.size() && this->slots[handle.slot].generation == handle.generation;
+    }
+
+    // Dense index of a live handle; only valid until the next despawn.
+    std::size_t index(EntityHandle handle) const { return this->slots[handle.slot].dense; }
+
+    std::size_t size() const { return this->xs.size(); }
+
+    void clear()
+    {
+        for (Uint32 slot : this->owners)
+        {
+            ++this->slots[slot].generation;
+            this->free_slots.push_back(slot);
+        }
+        this->xs.clear();
+        this->ys.clear();
+        this->xvels.clear();
+        this->yvels.clear();
+        this->ws.clear();
+        this->hs.clear();
+        this->textures.clear();
+        this->owners.clear();
+    }
+
+    float *x() { return this->xs.data(); }
+    float *y() { return this->ys.data(); }
+    float *xvel() { return this->xvels.data(); }
+    float *yvel() { return this->yvels.data(); }
+    float *w() { return this->ws.data(); }
+    float *h() { return this->hs.data(); }
+    SDL_Texture **texture() { return this->textures.data(); }
+    const float *x() const { return this->xs.data(); }
+    const float *y() const { return this->ys.data(); }
+    const float *xvel() const { return this->xvels.data(); }
+    const float *yvel() const { return this->yvels.data(); }
+    const float *w() const { return this->ws.data(); }
+    const float *h() const { return this->hs.data(); }
+    SDL_Texture *const *texture() const { return this->textures.data(); }
+
+    SDL_FRect rect(std::size_t i) const { return {this->xs[i], this->ys[i], this->ws[i], this->hs[i]}; }
+
+private:
+    struct Slot
+    {
+        Uint32 dense;
+        Uint32 generation;
+    };
+
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<float> xvels;
+    std::vector<float> yvels;
+    std::vector<float> ws;
+    std::vector<float> hs;
+    std::vector<SDL_Texture *> textures;
+    std::vector<Uint32> owners;
+    std::vector<Slot> slots;
+    std::vector<Uint32> free_slots;
+};
+
+// Moves entities [begin, end) one step and reflects them off the window edges,
+// the same rule Game::update_text used for its single rect. Returns the number
+// of reflections.
+inline std::size_t bounce_entities(EntityStore &entities, std::size_t begin, std::size_t end, float width,
+                                   float height)
+{
+    float *__restrict x = entities.x();
+    float *__restrict y = entities.y();
+    float *__restrict xvel = entities.xvel();
+    float *__restrict yvel = entities.yvel();
+    const float *w = entities.w();
+    const float *h = entities.h();
+    unsigned bounces = 0;
+
+    // Selects rather than branches, so the compiler can vectorize it.
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        float px = x[i] + xvel[i];
+        float py = y[i] + yvel[i];
+        float vx = xvel[i];
+        float vy = yvel[i];
+        float speed_x = std::fabs(vx);
+        float speed_y = std::fabs(vy);
+
+        float new_vx = px + w[i] > width ? -speed_x : vx;
+        new_vx = px < 0.0f ? speed_x : new_vx;
+        float new_vy = py + h[i] > height ? -speed_y : vy;
+        new_vy = py < 0.0f ? speed_y : new_vy;
+
+        bounces += (new_vx != vx) + (new_vy != vy);
+        x[i] = px;
+        y[i] = py;
+        xvel[i] = new_vx;
+        yvel[i] = new_vy;
+    }
+    return bounces;
+}
+
+inline std::size_t bounce_entities(EntityStore &entities, float width, float height)
+{
+    return bounce_entities(entities, 0, entities.size(), width, height);
+}
@@ -0,0 +1,369 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class CaptureFormat
+{
+    Png,
+    Y4m,
+};
+
+inline const char *to_string(CaptureFormat format)
+{
+    switch (format)
+    {
+    case CaptureFormat::Png:
+        return "png";
+    case CaptureFormat::Y4m:
+        return "y4m";
+    }
+    return "unknown";
+}
+
+/*
+Records presented frames without stalling the frame that presents them.
+
+capture() reads the back buffer into a frame from a fixed pool and queues it;
+that readback is the only work left on the render thread. Encoder threads
+take frames in capture order and either write frame-NNNNNN.png into the
+output directory or convert them to I420 and append them to one YUV4MPEG2
+stream, which ffmpeg and friends read directly:
+
+    ffmpeg -i capture.y4m capture.mp4
+
+PNG frames are independent files, so encoders write them in any order; Y4M
+frames are converted in parallel but appended strictly in sequence. When
+every pooled frame is still waiting to be encoded, capture() drops the frame
+and counts it rather than wait, so a slow disk costs frames, not frame rate.
+A Y4M stream plays dropped frames as if they never happened.
+*/
+class FrameCapture
+{
+public:
+    struct Stats
+    {
+        std::size_t captured;
+        std::size_t dropped;
+        std::size_t encoded;
+        std::size_t bytes_written;
+        double readback_ms;
+        double encode_ms;
+        double seconds;
+    };
+
+    // `output` is a directory for PNG and a file for Y4M.
+    FrameCapture(std::filesystem::path output, CaptureFormat format, int width, int height, int fps,
+                 std::size_t buffers = 6, unsigned encoders = std::max(1u, std::thread::hardware_concurrency() / 2))
+        : output{std::move(output)}, format{format}, width{width}, height{height}, pool(buffers),
+          start{SDL_GetPerformanceCounter()}
+    {
+        for (Frame &frame : this->pool)
+        {
+            frame.pixels.resize(static_cast<std::size_t>(width) * height);
+            this->free.push_back(&frame);
+        }
+
+        std::error_code ignored;
+        if (this->format == CaptureFormat::Png)
+        {
+            std::filesystem::create_directories(this->output, ignored);
+        }
+        else
+        {
+            std::filesystem::create_directories(this->output.parent_path(), ignored);
+            this->stream.open(this->output, std::ios::binary | std::ios::trunc);
+            if (!this->stream)
+            {
+                auto error = std::format("Error opening capture file: {}", this->output.string());
+                throw std::runtime_error(error);
+            }
+            this->stream << std::format("YUV4MPEG2 W{} H{} F{}:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n", width, height,
+                                        fps);
+        }
+
+        for (unsigned i = 0; i < encoders; ++i)
+        {
+            this->threads.emplace_back([this] { this->encode_loop(); });
+        }
+    }
+
+    FrameCapture(const FrameCapture &) = delete;
+    FrameCapture &operator=(const FrameCapture &) = delete;
+
+    ~FrameCapture() { this->stop(); }
+
+    // Call after drawing and before SDL_RenderPresent. False if the frame was dropped.
+    bool capture(SDL_Renderer *renderer)
+    {
+        Uint64 begin = SDL_GetPerformanceCounter();
+        Frame *frame = nullptr;
+        {
+            std::lock_guard lock{this->mutex};
+            if (this->free.empty())
+            {
+                ++this->counters.dropped;
+                return false;
+            }
+            frame = this->free.back();
+            this->free.pop_back();
+        }
+
+        // RGB888 is ARGB8888 with the alpha byte ignored: captures come out opaque.
+        if (SDL_RenderReadPixels(renderer, nullptr, SDL_PIXELFORMAT_RGB888, frame->pixels.data(),
+                                 this->width * 4))
+        {
+            std::lock_guard lock{this->mutex};
+            this->free.push_back(frame);
+            auto error = std::format("Error reading frame pixels: {}", SDL_GetError());
+            throw std::runtime_error(error);
+        }
+
+        {
+            std::lock_guard lock{this->mutex};
+            frame->sequence = this->counters.captured++;
+            this->pending.push_back(frame);
+            this->counters.readback_ms += static_cast<double>(SDL_GetPerformanceCounter() - begin) * 1e3 /
+                                          static_cast<double>(SDL_GetPerformanceFrequency());
+        }
+        this->work.notify_one();
+        return true;
+    }
+
+    // Encodes everything already captured, then rethrows the first encoder error if there was one.
+    void finish()
+    {
+        this->stop();
+        if (this->error)
+        {
+            std::rethrow_exception(this->error);
+        }
+    }
+
+    Stats stats() const
+    {
+        std::lock_guard lock{this->mutex};
+        return this->counters;
+    }
+
+    CaptureFormat kind() const { return this->format; }
+    const std::filesystem::path &path() const { return this->output; }
+
+private:
+    struct Frame
+    {
+        std::vector<Uint32> pixels;
+        std::vector<Uint8> yuv;
+        std::size_t sequence;
+    };
+
+    void stop()
+    {
+        {
+            std::lock_guard lock{this->mutex};
+            if (this->stopping)
+            {
+                return;
+            }
+            this->stopping = true;
+        }
+        this->work.notify_all();
+        for (auto &thread : this->threads)
+        {
+            thread.join();
+        }
+        this->stream.close();
+        std::lock_guard lock{this->mutex};
+        this->counters.seconds = static_cast<double>(SDL_GetPerformanceCounter() - this->start) /
+                                 static_cast<double>(SDL_GetPerformanceFrequency());
+    }
+
+    void encode_loop()
+    {
+        for (;;)
+        {
+            Frame *frame = nullptr;
+            {
+                std::unique_lock lock{this->mutex};
+                this->work.wait(lock, [this] { return this->stopping || !this->pending.empty(); });
+                if (this->pending.empty())
+                {
+                    return;
+                }
+                frame = this->pending.front();
+                this->pending.pop_front();
+            }
+
+            Uint64 begin = SDL_GetPerformanceCounter();
+            std::size_t bytes = 0;
+            bool encoded = false;
+            try
+            {
+                bytes = this->format == CaptureFormat::Png ? this->write_png(*frame) : this->write_y4m(*frame);
+                encoded = true;
+            }
+            catch (...)
+            {
+                std::lock_guard lock{this->mutex};
+                if (!this->error)
+                {
+                    this->error = std::current_exception();
+                }
+            }
+
+            {
+                std::lock_guard lock{this->mutex};
+                this->counters.encoded += encoded;
+                this->counters.bytes_written += bytes;
+                this->counters.encode_ms += static_cast<double>(SDL_GetPerformanceCounter() - begin) * 1e3 /
+                                            static_cast<double>(SDL_GetPerformanceFrequency());
+                this->free.push_back(frame);
+            }
+        }
+    }
+
+    std::size_t write_png(Frame &frame)
+    {
+        std::unique_ptr<SDL_Surface, decltype(&SDL_FreeSurface)> surface{
+            SDL_CreateRGBSurfaceWithFormatFrom(frame.pixels.data(), this->width, this->height, 32, this->width * 4,
+                                               SDL_PIXELFORMAT_RGB888),
+            SDL_FreeSurface};
+        auto path = this->output / std::format("frame-{:06}.png", frame.sequence);
+        if (!surface || IMG_SavePNG(surface.get(), path.string().c_str()))
+        {
+            auto error = std::format("Error saving capture frame: {}", IMG_GetError());
+            throw std::runtime_error(error);
+        }
+        std::error_code ignored;
+        return static_cast<std::size_t>(std::filesystem::file_size(path, ignored));
+    }
+
+    std::size_t write_y4m(Frame &frame)
+    {
+        std::exception_ptr failed;
+        try
+        {
+            this->convert_i420(frame);
+        }
+        catch (...)
+        {
+            failed = std::current_exception();
+        }
+
+        // Conversion runs in parallel; appending waits for the previous frame's turn. A frame that
+        // failed still takes its turn, unwritten, or every frame behind it would wait forever.
+        std::unique_lock lock{this->write_mutex};
+        this->written.wait(lock, [&] { return this->next_write == frame.sequence; });
+        bool written_ok = false;
+        if (!failed)
+        {
+            this->stream.write("FRAME\n", 6);
+            this->stream.write(reinterpret_cast<const char *>(frame.yuv.data()),
+                               static_cast<std::streamsize>(frame.yuv.size()));
+            written_ok = static_cast<bool>(this->stream);
+        }
+        ++this->next_write;
+        lock.unlock();
+        this->written.notify_all();
+
+        if (failed)
+        {
+            std::rethrow_exception(failed);
+        }
+        if (!written_ok)
+        {
+            auto error = std::format("Error writing capture file: {}", this->output.string());
+            throw std::runtime_error(error);
+        }
+        return frame.yuv.size() + 6;
+    }
+
+    // Full-range BT.601 with 8-bit fixed-point weights; chroma is the average of each 2x2 block.
+    void convert_i420(Frame &frame)
+    {
+        const int w = this->width, h = this->height;
+        const int cw = (w + 1) / 2, ch = (h + 1) / 2;
+        frame.yuv.resize(static_cast<std::size_t>(w) * h + 2 * static_cast<std::size_t>(cw) * ch);
+        Uint8 *luma = frame.yuv.data();
+        Uint8 *u = luma + static_cast<std::size_t>(w) * h;
+        Uint8 *v = u + static_cast<std::size_t>(cw) * ch;
+
+        auto channels = [](Uint32 pixel, int &r, int &g, int &b)
+        {
+            r = (pixel >> 16) & 0xff;
+            g = (pixel >> 8) & 0xff;
+            b = pixel & 0xff;
+        };
+        for (int y = 0; y < h; ++y)
+        {
+            const Uint32 *row = frame.pixels.data() + static_cast<std::size_t>(y) * w;
+            for (int x = 0; x < w; ++x)
+            {
+                int r, g, b;
+                channels(row[x], r, g, b);
+                luma[static_cast<std::size_t>(y) * w + x] = static_cast<Uint8>((77 * r + 150 * g + 29 * b + 128) >> 8);
+            }
+        }
+        for (int cy = 0; cy < ch; ++cy)
+        {
+            for (int cx = 0; cx < cw; ++cx)
+            {
+                int r = 0, g = 0, b = 0, n = 0;
+                for (int y = cy * 2; y < std::min(cy * 2 + 2, h); ++y)
+                {
+                    for (int x = cx * 2; x < std::min(cx * 2 + 2, w); ++x)
+                    {
+                        int pr, pg, pb;
+                        channels(frame.pixels[static_cast<std::size_t>(y) * w + x], pr, pg, pb);
+                        r += pr;
+                        g += pg;
+                        b += pb;
+                        ++n;
+                    }
+                }
+                r /= n;
+                g /= n;
+                b /= n;
+                std::size_t i = static_cast<std::size_t>(cy) * cw + cx;
+                u[i] = static_cast<Uint8>(std::clamp((-43 * r - 85 * g + 128 * b + 128) / 256 + 128, 0, 255));
+                v[i] = static_cast<Uint8>(std::clamp((128 * r - 107 * g - 21 * b + 128) / 256 + 128, 0, 255));
+            }
+        }
+    }
+
+    std::filesystem::path output;
+    CaptureFormat format;
+    int width;
+    int height;
+    std::vector<Frame> pool;
+    Uint64 start;
+
+    mutable std::mutex mutex;
+    std::condition_variable work;
+    std::vector<Frame *> free;
+    std::deque<Frame *> pending;
+    bool stopping{false};
+    std::exception_ptr error;
+    Stats counters{};
+
+    std::mutex write_mutex;
+    std::condition_variable written;
+    std::size_t next_write{0};
+    std::ofstream stream;
+
+    std::vector<std::thread> threads;
+};
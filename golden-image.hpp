@@ -0,0 +1,188 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <filesystem>
+#include <format>
+#include <stdexcept>
+
+#include "soft-blitter.hpp"
+
+/*
+Pixel comparison for golden-image tests.
+
+Images are RGB888 surfaces; the unused top byte is masked off. A pixel
+differs when any channel is more than `tolerance` away from the golden one.
+The comparison runs once per captured frame on every test run, so it uses
+the same runtime-picked SSE2/AVX2 kernels as the compositor (saturating
+byte subtraction both ways gives |a - b| per channel). The diff image, only
+built when something differs, shows differing pixels in red over a dimmed
+copy of the golden image.
+*/
+struct ImageDiff
+{
+    std::size_t pixels;
+    std::size_t differing;
+    int max_delta;
+};
+
+inline void diff_span(const Uint32 *a, const Uint32 *b, int count, int tolerance, ImageDiff &diff)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        int worst = 0;
+        for (int shift = 0; shift < 24; shift += 8)
+        {
+            int delta = static_cast<int>((a[i] >> shift) & 0xff) - static_cast<int>((b[i] >> shift) & 0xff);
+            worst = std::max(worst, delta < 0 ? -delta : delta);
+        }
+        diff.max_delta = std::max(diff.max_delta, worst);
+        diff.differing += worst > tolerance;
+    }
+}
+
+#ifdef BLEND_KERNEL_X86
+inline void diff_span_sse2(const Uint32 *a, const Uint32 *b, int count, int tolerance, ImageDiff &diff)
+{
+    const __m128i rgb = _mm_set1_epi32(0x00ffffff);
+    const __m128i limit = _mm_set1_epi8(static_cast<char>(tolerance));
+    const __m128i zero = _mm_setzero_si128();
+    __m128i worst = zero;
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i x = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)), rgb);
+        __m128i y = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)), rgb);
+        __m128i delta = _mm_or_si128(_mm_subs_epu8(x, y), _mm_subs_epu8(y, x));
+        worst = _mm_max_epu8(worst, delta);
+        __m128i within = _mm_cmpeq_epi32(_mm_subs_epu8(delta, limit), zero);
+        diff.differing += 4 - std::popcount(static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(within))));
+    }
+    alignas(16) Uint8 bytes[16];
+    _mm_store_si128(reinterpret_cast<__m128i *>(bytes), worst);
+    diff.max_delta = std::max<int>(diff.max_delta, *std::max_element(bytes, bytes + 16));
+    diff_span(a + i, b + i, count - i, tolerance, diff);
+}
+
+BLEND_TARGET_AVX2 inline void diff_span_avx2(const Uint32 *a, const Uint32 *b, int count, int tolerance,
+                                             ImageDiff &diff)
+{
+    const __m256i rgb = _mm256_set1_epi32(0x00ffffff);
+    const __m256i limit = _mm256_set1_epi8(static_cast<char>(tolerance));
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i worst = zero;
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i x = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)), rgb);
+        __m256i y = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i)), rgb);
+        __m256i delta = _mm256_or_si256(_mm256_subs_epu8(x, y), _mm256_subs_epu8(y, x));
+        worst = _mm256_max_epu8(worst, delta);
+        __m256i within = _mm256_cmpeq_epi32(_mm256_subs_epu8(delta, limit), zero);
+        diff.differing += 8 - std::popcount(static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(within))));
+    }
+    alignas(32) Uint8 bytes[32];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(bytes), worst);
+    diff.max_delta = std::max<int>(diff.max_delta, *std::max_element(bytes, bytes + 32));
+    diff_span(a + i, b + i, count - i, tolerance, diff);
+}
+#endif
+
+inline void diff_span(const Uint32 *a, const Uint32 *b, int count, int tolerance, ImageDiff &diff,
+                      BlendKernel kernel)
+{
+    switch (kernel)
+    {
+#ifdef BLEND_KERNEL_X86
+    case BlendKernel::AVX2:
+        diff_span_avx2(a, b, count, tolerance, diff);
+        return;
+    case BlendKernel::SSE2:
+        diff_span_sse2(a, b, count, tolerance, diff);
+        return;
+#endif
+    default:
+        diff_span(a, b, count, tolerance, diff);
+    }
+}
+
+inline const Uint32 *surface_row(const SDL_Surface *surface, int y)
+{
+    return reinterpret_cast<const Uint32 *>(static_cast<const Uint8 *>(surface->pixels) +
+                                            static_cast<std::size_t>(y) * surface->pitch);
+}
+
+// Both surfaces RGB888. Images of different sizes differ in every pixel.
+inline ImageDiff diff_images(const SDL_Surface *actual, const SDL_Surface *expected, int tolerance,
+                             BlendKernel kernel = best_blend_kernel())
+{
+    ImageDiff diff{static_cast<std::size_t>(actual->w) * actual->h, 0, 0};
+    if (actual->w != expected->w || actual->h != expected->h)
+    {
+        diff.differing = diff.pixels;
+        diff.max_delta = 255;
+        return diff;
+    }
+    for (int y = 0; y < actual->h; ++y)
+    {
+        diff_span(surface_row(actual, y), surface_row(expected, y), actual->w, tolerance, diff, kernel);
+    }
+    return diff;
+}
+
+inline SurfacePtr diff_image(const SDL_Surface *actual, const SDL_Surface *expected, int tolerance)
+{
+    SurfacePtr out{SDL_CreateRGBSurfaceWithFormat(0, actual->w, actual->h, 32, SDL_PIXELFORMAT_RGB888),
+                   SDL_FreeSurface};
+    if (!out)
+    {
+        auto error = std::format("Error creating diff Surface: {}", SDL_GetError());
+        throw std::runtime_error(error);
+    }
+    for (int y = 0; y < actual->h; ++y)
+    {
+        auto *row = const_cast<Uint32 *>(surface_row(out.get(), y));
+        for (int x = 0; x < actual->w; ++x)
+        {
+            bool inside = x < expected->w && y < expected->h;
+            Uint32 golden = inside ? surface_row(expected, y)[x] : 0;
+            ImageDiff pixel{1, 0, 0};
+            diff_span(surface_row(actual, y) + x, &golden, 1, tolerance, pixel);
+            // A quarter-brightness grey of the golden pixel, so the red stands out.
+            Uint32 grey = (((golden >> 16) & 0xff) + ((golden >> 8) & 0xff) + (golden & 0xff)) / 12;
+            row[x] = !inside || pixel.differing ? 0xffff0000 : 0xff000000 | grey << 16 | grey << 8 | grey;
+        }
+    }
+    return out;
+}
+
+// Loads any image SDL_image reads as RGB888.
+inline SurfacePtr load_rgb(const std::filesystem::path &path)
+{
+    SurfacePtr loaded{IMG_Load(path.string().c_str()), SDL_FreeSurface};
+    if (!loaded)
+    {
+        return {nullptr, SDL_FreeSurface};
+    }
+    SurfacePtr converted{SDL_ConvertSurfaceFormat(loaded.get(), SDL_PIXELFORMAT_RGB888, 0), SDL_FreeSurface};
+    if (!converted)
+    {
+        auto error = std::format("Error converting {}: {}", path.string(), SDL_GetError());
+        throw std::runtime_error(error);
+    }
+    return converted;
+}
+
+inline void save_png(SDL_Surface *surface, const std::filesystem::path &path)
+{
+    std::error_code ignored;
+    std::filesystem::create_directories(path.parent_path(), ignored);
+    if (IMG_SavePNG(surface, path.string().c_str()))
+    {
+        auto error = std::format("Error saving {}: {}", path.string(), IMG_GetError());
+        throw std::runtime_error(error);
+    }
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Game input for one simulation tick: keys held during it and keys pressed since the last tick.
+struct InputFrame
+{
+    Uint16 held;
+    Uint16 pressed;
+
+    bool is_held(int bit) const { return this->held & (1u << bit); }
+    bool was_pressed(int bit) const { return this->pressed & (1u << bit); }
+};
+
+/*
+Everything a simulation run depends on besides the code: the RNG seed, the
+tick rate and one InputFrame per tick. Each tick also stores a checksum of
+the game state after it, so a replay can name the first tick that diverges.
+
+input file (little-endian)
+  InputHeader (24 bytes)
+  per tick: held (2) pressed (2) checksum (4)
+*/
+class InputRecording
+{
+public:
+    struct Tick
+    {
+        InputFrame input;
+        Uint32 checksum;
+    };
+    static_assert(sizeof(Tick) == 8);
+
+    Uint64 seed{0};
+    Uint32 tick_rate{60};
+    std::vector<Tick> ticks;
+
+    void save(const std::string &path) const
+    {
+        InputHeader header{};
+        std::memcpy(header.magic, "INP1", 4);
+        header.tick_rate = this->tick_rate;
+        header.seed = this->seed;
+        header.count = this->ticks.size();
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(this->ticks.data()),
+                  static_cast<std::streamsize>(this->ticks.size() * sizeof(Tick)));
+        if (!out)
+        {
+            auto error = std::format("Error writing input recording: {}", path);
+            throw std::runtime_error(error);
+        }
+    }
+
+    static InputRecording load(const std::string &path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        InputHeader header{};
+        in.read(reinterpret_cast<char *>(&header), sizeof(header));
+        if (!in || std::memcmp(header.magic, "INP1", 4) || header.tick_rate == 0)
+        {
+            auto error = std::format("Error reading input recording: {}", path);
+            throw std::runtime_error(error);
+        }
+
+        // Checked before resize(), so a corrupt count is a read error rather than std::bad_alloc.
+        std::streamoff ticks_at = in.tellg();
+        in.seekg(0, std::ios::end);
+        std::streamoff remaining = in.tellg() - ticks_at;
+        in.seekg(ticks_at);
+        if (!in || header.count > static_cast<Uint64>(remaining) / sizeof(Tick))
+        {
+            auto error = std::format("Error reading input recording: {} is truncated", path);
+            throw std::runtime_error(error);
+        }
+
+        InputRecording recording;
+        recording.seed = header.seed;
+        recording.tick_rate = header.tick_rate;
+        recording.ticks.resize(header.count);
+        in.read(reinterpret_cast<char *>(recording.ticks.data()),
+                static_cast<std::streamsize>(header.count * sizeof(Tick)));
+        if (!in)
+        {
+            auto error = std::format("Error reading input recording: {} is truncated", path);
+            throw std::runtime_error(error);
+        }
+        return recording;
+    }
+
+private:
+    struct InputHeader
+    {
+        char magic[4];
+        Uint32 tick_rate;
+        Uint64 seed;
+        Uint64 count;
+    };
+    static_assert(sizeof(InputHeader) == 24);
+};
+
+// FNV-1a over raw bytes, for the per-tick checksums.
+inline Uint32 checksum_bytes(Uint32 hash, const void *data, std::size_t size)
+{
+    const Uint8 *bytes = static_cast<const Uint8 *>(data);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
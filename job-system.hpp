@@ -0,0 +1,392 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+/*
+Counts outstanding jobs. wait() on it runs queued jobs until it drops to
+zero, and jobs queued with run_after() are
+released the moment it does.
+*/
+class JobCounter
+{
+public:
+    bool done() const { return this->pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    struct Continuation
+    {
+        void (*invoke)(const void *, std::size_t, std::size_t);
+        const void *fn;
+        std::size_t begin;
+        std::size_t end;
+        JobCounter *counter;
+    };
+
+    std::atomic<int> pending{0};
+    std::mutex mutex;
+    std::vector<Continuation> continuations;
+};
+
+/*
+Work-stealing scheduler.
+
+Every worker, and the thread that created the system, owns a queue: the
+owner pushes and pops at the back (most recent, still in cache), idle
+workers steal from the front of someone else's (oldest, usually the biggest
+piece of work left). Jobs are a function pointer plus a [begin, end) range;
+the callable itself lives on the stack of whoever waits for the counter.
+
+Other threads that submit work hold a ThreadScope, which lends them a queue
+of their own; without one they would share the creating thread's. Threads
+that are not workers only ever run jobs from their own queue, so a render
+thread waiting on its compositor bands never picks up a simulation chunk
+and stalls the frame on it, nor the other way round. Workers steal from
+everyone.
+*/
+class JobSystem
+{
+public:
+    // Claims a queue for the current thread until it goes out of scope.
+    class ThreadScope
+    {
+    public:
+        explicit ThreadScope(JobSystem &jobs)
+            : jobs{jobs}, previous_system{worker_system}, previous_index{worker_index}
+        {
+            worker_index = jobs.claim_slot();
+            worker_system = &jobs;
+        }
+        ThreadScope(const ThreadScope &) = delete;
+        ThreadScope &operator=(const ThreadScope &) = delete;
+        ~ThreadScope()
+        {
+            this->jobs.release_slot(worker_index);
+            worker_system = this->previous_system;
+            worker_index = this->previous_index;
+        }
+
+    private:
+        JobSystem &jobs;
+        const JobSystem *previous_system;
+        unsigned previous_index;
+    };
+
+    // workers = extra threads; the owning thread always participates as worker 0.
+    // attached = how many other threads may hold a ThreadScope at once.
+    explicit JobSystem(unsigned workers = std::max(1u, std::thread::hardware_concurrency()) - 1,
+                       unsigned attached = 1)
+        : queues(workers + 1 + attached)
+    {
+        for (auto &queue : this->queues)
+        {
+            queue = std::make_unique<Queue>();
+        }
+        for (unsigned i = workers + 1 + attached; i > workers + 1; --i)
+        {
+            this->spare_slots.push_back(i - 1);
+        }
+        for (unsigned i = 1; i <= workers; ++i)
+        {
+            this->threads.emplace_back([this, i] { this->worker_loop(i); });
+        }
+    }
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    ~JobSystem()
+    {
+        {
+            std::lock_guard lock{this->sleep_mutex};
+            this->stopping = true;
+        }
+        this->wake.notify_all();
+        for (auto &thread : this->threads)
+        {
+            thread.join();
+        }
+    }
+
+    // Threads a parallel_for from the owning thread spreads over.
+    unsigned thread_count() const { return static_cast<unsigned>(this->threads.size() + 1); }
+    std::size_t steal_count() const { return this->steals.load(std::memory_order_relaxed); }
+
+    // Queues fn(begin, end) for [begin, end) split into pieces of at most `grain`.
+    // `fn` must outlive the counter reaching zero.
+    template <typename Fn>
+    void run(JobCounter &counter, std::size_t begin, std::size_t end, std::size_t grain, const Fn &fn)
+    {
+        grain = std::max<std::size_t>(grain, 1);
+        int jobs = static_cast<int>((end - begin + grain - 1) / grain);
+        if (jobs <= 0)
+        {
+            return;
+        }
+        counter.pending.fetch_add(jobs, std::memory_order_relaxed);
+
+        Queue &queue = *this->queues[this->current_worker()];
+        {
+            std::lock_guard lock{queue.mutex};
+            for (std::size_t b = begin; b < end; b += grain)
+            {
+                queue.push_back({&invoke<Fn>, &fn, b, std::min(b + grain, end), &counter});
+            }
+        }
+        this->queued.fetch_add(jobs, std::memory_order_release);
+        this->notify(jobs);
+    }
+
+    // Like run(), but only queued once `dependency` reaches zero.
+    template <typename Fn>
+    void run_after(JobCounter &dependency, JobCounter &counter, std::size_t begin, std::size_t end,
+                   std::size_t grain, const Fn &fn)
+    {
+        grain = std::max<std::size_t>(grain, 1);
+        {
+            std::lock_guard lock{dependency.mutex};
+            if (!dependency.done())
+            {
+                for (std::size_t b = begin; b < end; b += grain)
+                {
+                    counter.pending.fetch_add(1, std::memory_order_relaxed);
+                    dependency.continuations.push_back({&invoke<Fn>, &fn, b, std::min(b + grain, end), &counter});
+                }
+                return;
+            }
+        }
+        this->run(counter, begin, end, grain, fn);
+    }
+
+    // Runs jobs, its own first (only its own off the worker threads), until the counter reaches zero.
+    void wait(JobCounter &counter)
+    {
+        unsigned self = this->current_worker();
+        bool steal = self != 0 && self <= this->threads.size();
+        while (!counter.done())
+        {
+            Job job;
+            if (this->take(self, job, steal))
+            {
+                this->execute(job);
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+        // The job that finished the counter may still be unlocking it.
+        std::lock_guard lock{counter.mutex};
+    }
+
+    template <typename Fn>
+    void parallel_for(std::size_t begin, std::size_t end, std::size_t grain, const Fn &fn)
+    {
+        JobCounter counter;
+        this->run(counter, begin, end, grain, fn);
+        this->wait(counter);
+    }
+
+private:
+    using Job = JobCounter::Continuation;
+
+    /*
+    A ring of jobs: the owner pushes and pops at the back, thieves pop at the
+    front. Capacity doubles when full and never shrinks, so once a queue has
+    seen its deepest frame, queuing jobs no longer allocates (a std::deque
+    frees and reallocates blocks as jobs flow through it).
+    */
+    struct Queue
+    {
+        std::mutex mutex;
+        std::vector<Job> ring = std::vector<Job>(256);
+        std::size_t head{0};
+        std::size_t count{0};
+
+        bool empty() const { return this->count == 0; }
+
+        void push_back(const Job &job)
+        {
+            if (this->count == this->ring.size())
+            {
+                std::vector<Job> bigger(this->ring.size() * 2);
+                for (std::size_t i = 0; i < this->count; ++i)
+                {
+                    bigger[i] = this->ring[(this->head + i) & (this->ring.size() - 1)];
+                }
+                this->ring.swap(bigger);
+                this->head = 0;
+            }
+            this->ring[(this->head + this->count++) & (this->ring.size() - 1)] = job;
+        }
+
+        Job pop_back() { return this->ring[(this->head + --this->count) & (this->ring.size() - 1)]; }
+
+        Job pop_front()
+        {
+            Job job = this->ring[this->head];
+            this->head = (this->head + 1) & (this->ring.size() - 1);
+            --this->count;
+            return job;
+        }
+    };
+
+    template <typename Fn>
+    static void invoke(const void *fn, std::size_t begin, std::size_t end)
+    {
+        (*static_cast<const Fn *>(fn))(begin, end);
+    }
+
+    // 0 for the owning thread and any other thread without a ThreadScope.
+    unsigned current_worker() const { return worker_system == this ? worker_index : 0; }
+
+    unsigned claim_slot()
+    {
+        std::lock_guard lock{this->sleep_mutex};
+        if (this->spare_slots.empty())
+        {
+            auto error = std::format("Error attaching to job system: all {} thread slots are taken",
+                                     this->queues.size() - this->threads.size() - 1);
+            throw std::runtime_error(error);
+        }
+        unsigned slot = this->spare_slots.back();
+        this->spare_slots.pop_back();
+        return slot;
+    }
+
+    // The thread has waited for everything it queued, so the queue is empty again.
+    void release_slot(unsigned slot)
+    {
+        std::lock_guard lock{this->sleep_mutex};
+        this->spare_slots.push_back(slot);
+    }
+
+    void notify(int jobs)
+    {
+        if (this->threads.empty())
+        {
+            return;
+        }
+        std::lock_guard lock{this->sleep_mutex};
+        if (jobs > 1)
+        {
+            this->wake.notify_all();
+        }
+        else
+        {
+            this->wake.notify_one();
+        }
+    }
+
+    bool take(unsigned self, Job &job, bool steal = true)
+    {
+        {
+            Queue &own = *this->queues[self];
+            std::lock_guard lock{own.mutex};
+            if (!own.empty())
+            {
+                job = own.pop_back();
+                this->queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        if (!steal)
+        {
+            return false;
+        }
+
+        std::size_t count = this->queues.size();
+        for (std::size_t k = 1; k < count; ++k)
+        {
+            Queue &victim = *this->queues[(self + k) % count];
+            std::unique_lock lock{victim.mutex, std::try_to_lock};
+            if (lock && !victim.empty())
+            {
+                job = victim.pop_front();
+                this->queued.fetch_sub(1, std::memory_order_relaxed);
+                this->steals.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void execute(const Job &job)
+    {
+        job.invoke(job.fn, job.begin, job.end);
+
+        // The last job of a group releases anything queued behind it. Decrementing
+        // under the lock lets wait() know when nobody touches the counter any more.
+        std::vector<Job> released;
+        {
+            JobCounter &counter = *job.counter;
+            std::lock_guard lock{counter.mutex};
+            if (counter.pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                released.swap(counter.continuations);
+            }
+        }
+        if (released.empty())
+        {
+            return;
+        }
+        Queue &queue = *this->queues[this->current_worker()];
+        {
+            std::lock_guard lock{queue.mutex};
+            for (const Job &job : released)
+            {
+                queue.push_back(job);
+            }
+        }
+        this->queued.fetch_add(static_cast<int>(released.size()), std::memory_order_release);
+        this->notify(static_cast<int>(released.size()));
+    }
+
+    void worker_loop(unsigned self)
+    {
+        worker_system = this;
+        worker_index = self;
+
+        while (true)
+        {
+            Job job;
+            if (this->take(self, job))
+            {
+                this->execute(job);
+                continue;
+            }
+
+            std::unique_lock lock{this->sleep_mutex};
+            this->wake.wait(lock, [this]
+                            { return this->stopping || this->queued.load(std::memory_order_acquire) > 0; });
+            if (this->stopping)
+            {
+                return;
+            }
+        }
+    }
+
+    static inline thread_local const JobSystem *worker_system{nullptr};
+    static inline thread_local unsigned worker_index{0};
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::vector<unsigned> spare_slots;
+    std::atomic<int> queued{0};
+    std::atomic<std::size_t> steals{0};
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    bool stopping{false};
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/*
+Static layers composited once into a render-target texture.
+
+Each static layer is a draw function. The first draw() (and the first after
+any invalidate()) runs them in order into a window-sized
+SDL_TEXTUREACCESS_TARGET texture; every other frame is a single unblended
+RenderCopy of that texture, whatever the layers cost to draw. Dynamic content
+is drawn on top by the caller.
+
+Renderers without render-target support, or a failed texture creation, fall
+back to running the layers every frame.
+*/
+class LayerCache
+{
+public:
+    using DrawFn = std::function<void(SDL_Renderer *)>;
+
+    LayerCache(int width, int height) : width{width}, height{height} {}
+
+    int add_static(DrawFn draw)
+    {
+        this->layers.push_back({std::move(draw), true});
+        this->dirty = true;
+        return static_cast<int>(this->layers.size() - 1);
+    }
+
+    void set_enabled(int layer, bool enabled)
+    {
+        if (this->layers[layer].enabled != enabled)
+        {
+            this->layers[layer].enabled = enabled;
+            this->dirty = true;
+        }
+    }
+
+    bool enabled(int layer) const { return this->layers[layer].enabled; }
+
+    // After a layer's content changed, or SDL_RENDER_TARGETS_RESET / SDL_RENDER_DEVICE_RESET.
+    void invalidate() { this->dirty = true; }
+
+    void draw(SDL_Renderer *renderer)
+    {
+        if (!this->texture && !this->fallback)
+        {
+            this->create(renderer);
+        }
+        if (this->fallback)
+        {
+            this->draw_layers(renderer);
+            return;
+        }
+
+        if (this->dirty)
+        {
+            SDL_Texture *previous = SDL_GetRenderTarget(renderer);
+            SDL_SetRenderTarget(renderer, this->texture.get());
+            SDL_RenderClear(renderer);
+            this->draw_layers(renderer);
+            SDL_SetRenderTarget(renderer, previous);
+            this->dirty = false;
+            ++this->rebuild_count;
+        }
+        SDL_RenderCopy(renderer, this->texture.get(), nullptr, nullptr);
+    }
+
+    // True when the next draw() runs the layers instead of copying the cached texture.
+    bool stale() const { return this->dirty || !this->texture; }
+
+    int rebuilds() const { return this->rebuild_count; }
+    bool cached() const { return this->texture != nullptr; }
+
+private:
+    struct Layer
+    {
+        DrawFn draw;
+        bool enabled;
+    };
+
+    void create(SDL_Renderer *renderer)
+    {
+        if (SDL_RenderTargetSupported(renderer))
+        {
+            this->texture.reset(SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+                                                  this->width, this->height));
+        }
+        if (!this->texture)
+        {
+            this->fallback = true;
+            return;
+        }
+        // Opaque copy: the cheapest path the software renderer has.
+        SDL_SetTextureBlendMode(this->texture.get(), SDL_BLENDMODE_NONE);
+        this->dirty = true;
+    }
+
+    // Layers may change the draw colour and blend mode; the caller gets its own back.
+    void draw_layers(SDL_Renderer *renderer)
+    {
+        Uint8 r, g, b, a;
+        SDL_BlendMode blend;
+        SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+        SDL_GetRenderDrawBlendMode(renderer, &blend);
+        for (const Layer &layer : this->layers)
+        {
+            if (layer.enabled)
+            {
+                layer.draw(renderer);
+            }
+        }
+        SDL_SetRenderDrawColor(renderer, r, g, b, a);
+        SDL_SetRenderDrawBlendMode(renderer, blend);
+    }
+
+    int width;
+    int height;
+    std::vector<Layer> layers;
+    std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)> texture{nullptr, SDL_DestroyTexture};
+    bool dirty{true};
+    bool fallback{false};
+    int rebuild_count{0};
+};
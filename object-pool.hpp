@@ -0,0 +1,214 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+struct PoolHandle
+{
+    Uint32 index;
+    Uint32 generation;
+
+    explicit operator bool() const { return this->generation != 0; }
+};
+
+/*
+Pool of T with a free list and generation-checked handles.
+
+Slots come in power-of-two blocks that never move, so pointers from get()
+stay valid until the object is destroyed. A Fixed pool owns a single block
+and create() fails once it is full; a Growable pool adds a block instead.
+Either way the allocator is only called when a block is added, so a pool
+that has reached its working size spawns and destroys without allocating.
+
+Generations start at 1 and bump on destroy, so a default handle and any
+handle to a destroyed object both fail get().
+*/
+template <typename T>
+class ObjectPool
+{
+public:
+    enum class Growth
+    {
+        Fixed,
+        Growable,
+    };
+
+    struct Stats
+    {
+        std::size_t capacity;
+        std::size_t live;
+        std::size_t peak;
+        std::size_t created;
+        std::size_t destroyed;
+        std::size_t full;
+        std::size_t stale;
+        std::size_t blocks;
+    };
+
+    explicit ObjectPool(std::size_t block_size, Growth growth = Growth::Fixed) : growth{growth}
+    {
+        while ((std::size_t{1} << this->block_bits) < std::max<std::size_t>(block_size, 1))
+        {
+            ++this->block_bits;
+        }
+        this->add_block();
+    }
+
+    ObjectPool(const ObjectPool &) = delete;
+    ObjectPool &operator=(const ObjectPool &) = delete;
+
+    ~ObjectPool() { this->clear(); }
+
+    // Null handle if a Fixed pool is full.
+    template <typename... Args>
+    PoolHandle create(Args &&...args)
+    {
+        if (this->free_head == no_slot)
+        {
+            if (this->growth == Growth::Fixed)
+            {
+                ++this->counters.full;
+                return {0, 0};
+            }
+            this->add_block();
+        }
+
+        Uint32 index = this->free_head;
+        Slot &slot = this->slot(index);
+        new (slot.storage) T(std::forward<Args>(args)...);
+        this->free_head = slot.next_free;
+        slot.alive = true;
+
+        ++this->live_count;
+        ++this->counters.created;
+        this->counters.peak = std::max(this->counters.peak, this->live_count);
+        return {index, slot.generation};
+    }
+
+    bool destroy(PoolHandle handle)
+    {
+        if (!this->get(handle))
+        {
+            return false;
+        }
+        this->release(handle.index);
+        return true;
+    }
+
+    T *get(PoolHandle handle)
+    {
+        if (handle.index < this->capacity())
+        {
+            Slot &slot = this->slot(handle.index);
+            if (slot.alive && slot.generation == handle.generation)
+            {
+                return slot.object();
+            }
+        }
+        if (handle)
+        {
+            ++this->counters.stale;
+        }
+        return nullptr;
+    }
+
+    // fn(handle, object) for every live object; fn may destroy the object it is given.
+    template <typename Fn>
+    void for_each(Fn &&fn)
+    {
+        std::size_t count = this->capacity();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            Slot &slot = this->slot(static_cast<Uint32>(i));
+            if (slot.alive)
+            {
+                fn(PoolHandle{static_cast<Uint32>(i), slot.generation}, *slot.object());
+            }
+        }
+    }
+
+    void clear()
+    {
+        std::size_t count = this->capacity();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (this->slot(static_cast<Uint32>(i)).alive)
+            {
+                this->release(static_cast<Uint32>(i));
+            }
+        }
+    }
+
+    std::size_t size() const { return this->live_count; }
+    std::size_t capacity() const { return this->blocks.size() << this->block_bits; }
+
+    Stats stats() const
+    {
+        Stats stats = this->counters;
+        stats.capacity = this->capacity();
+        stats.live = this->live_count;
+        stats.blocks = this->blocks.size();
+        return stats;
+    }
+
+private:
+    static constexpr Uint32 no_slot = 0xffffffff;
+
+    struct Slot
+    {
+        alignas(T) unsigned char storage[sizeof(T)];
+        Uint32 generation;
+        Uint32 next_free;
+        bool alive;
+
+        T *object() { return std::launder(reinterpret_cast<T *>(this->storage)); }
+    };
+
+    Slot &slot(Uint32 index)
+    {
+        return this->blocks[index >> this->block_bits][index & ((Uint32{1} << this->block_bits) - 1)];
+    }
+
+    void release(Uint32 index)
+    {
+        Slot &slot = this->slot(index);
+        slot.object()->~T();
+        slot.alive = false;
+        if (++slot.generation == 0)
+        {
+            slot.generation = 1;
+        }
+        slot.next_free = this->free_head;
+        this->free_head = index;
+
+        --this->live_count;
+        ++this->counters.destroyed;
+    }
+
+    // New slots are chained in index order, so a fresh pool fills front to back.
+    void add_block()
+    {
+        std::size_t size = std::size_t{1} << this->block_bits;
+        Uint32 first = static_cast<Uint32>(this->capacity());
+        auto &block = this->blocks.emplace_back(std::make_unique<Slot[]>(size));
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            block[i].generation = 1;
+            block[i].alive = false;
+            block[i].next_free = i + 1 < size ? first + static_cast<Uint32>(i) + 1 : this->free_head;
+        }
+        this->free_head = first;
+    }
+
+    Growth growth;
+    unsigned block_bits{0};
+    std::vector<std::unique_ptr<Slot[]>> blocks;
+    Uint32 free_head{no_slot};
+    std::size_t live_count{0};
+    Stats counters{};
+};
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "audio-queue.hpp"
+
+struct ScriptedCommand
+{
+    Uint64 frame;
+    AudioCommand command;
+};
+
+/*
+Renders the mixer faster than realtime with no sound card.
+
+SDL's "disk" audio driver with SDL_DISKAUDIODELAY=0 calls the mixer back to
+back, so the only clock is the number of frames mixed so far. The post-mix
+callback captures each buffer and applies every scripted command whose frame
+falls inside it; those take effect from the next buffer, so the output depends
+only on the script and the chunk size, never on wall-clock timing.
+*/
+class OfflineAudioRenderer
+{
+public:
+    struct Result
+    {
+        Uint64 frames;
+        int channels;
+        double seconds;
+        double samples_per_second;
+        double realtime_factor;
+    };
+
+    // Call before SDL_Init(SDL_INIT_AUDIO).
+    static void use_disk_driver()
+    {
+#ifdef _WIN32
+        SDL_setenv("SDL_DISKAUDIOFILE", "NUL", 1);
+#else
+        SDL_setenv("SDL_DISKAUDIOFILE", "/dev/null", 1);
+#endif
+        SDL_setenv("SDL_DISKAUDIODELAY", "0", 1);
+        SDL_SetHint(SDL_HINT_AUDIODRIVER, "disk");
+    }
+
+    OfflineAudioRenderer(std::vector<ScriptedCommand> script, Uint64 total_frames)
+        : script{std::move(script)}, total_frames{total_frames}
+    {
+        std::stable_sort(this->script.begin(), this->script.end(),
+                         [](const ScriptedCommand &a, const ScriptedCommand &b)
+                         { return a.frame < b.frame; });
+    }
+
+    // Needs the audio device open; blocks until total_frames have been mixed.
+    Result render()
+    {
+        if (!Mix_QuerySpec(&this->frequency, &this->format, &this->channels))
+        {
+            auto error = std::format("Error querying audio device: {}", Mix_GetError());
+            throw std::runtime_error(error);
+        }
+        this->frame_bytes = SDL_AUDIO_BITSIZE(this->format) / 8 * this->channels;
+        this->samples.assign(this->total_frames * this->frame_bytes, 0);
+        this->clock = 0;
+        this->next_command = 0;
+        this->started = false;
+        this->done = false;
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        Mix_SetPostMix(&OfflineAudioRenderer::postmix, this);
+
+        while (!this->done.load(std::memory_order_acquire))
+        {
+            SDL_Delay(1);
+        }
+        Mix_SetPostMix(nullptr, nullptr);
+
+        double seconds = static_cast<double>(SDL_GetPerformanceCounter() - start) /
+                         static_cast<double>(SDL_GetPerformanceFrequency());
+        double samples_mixed = static_cast<double>(this->total_frames) * this->channels;
+        return {this->total_frames, this->channels, seconds, samples_mixed / seconds,
+                static_cast<double>(this->total_frames) / this->frequency / seconds};
+    }
+
+    void write_wav(const std::string &path) const
+    {
+        if (SDL_AUDIO_ISBIGENDIAN(this->format) && SDL_AUDIO_BITSIZE(this->format) > 8)
+        {
+            throw std::runtime_error("Error writing WAV: big-endian samples are not supported");
+        }
+
+        auto put16 = [](std::ofstream &out, Uint16 value)
+        {
+            Uint8 bytes[2] = {Uint8(value), Uint8(value >> 8)};
+            out.write(reinterpret_cast<const char *>(bytes), 2);
+        };
+        auto put32 = [](std::ofstream &out, Uint32 value)
+        {
+            Uint8 bytes[4] = {Uint8(value), Uint8(value >> 8), Uint8(value >> 16), Uint8(value >> 24)};
+            out.write(reinterpret_cast<const char *>(bytes), 4);
+        };
+
+        Uint32 data_size = static_cast<Uint32>(this->samples.size());
+        Uint16 bits = SDL_AUDIO_BITSIZE(this->format);
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write("RIFF", 4);
+        put32(out, 36 + data_size);
+        out.write("WAVEfmt ", 8);
+        put32(out, 16);
+        put16(out, SDL_AUDIO_ISFLOAT(this->format) ? 3 : 1);
+        put16(out, static_cast<Uint16>(this->channels));
+        put32(out, static_cast<Uint32>(this->frequency));
+        put32(out, static_cast<Uint32>(this->frequency * this->frame_bytes));
+        put16(out, static_cast<Uint16>(this->frame_bytes));
+        put16(out, bits);
+        out.write("data", 4);
+        put32(out, data_size);
+        out.write(reinterpret_cast<const char *>(this->samples.data()), data_size);
+        if (!out)
+        {
+            auto error = std::format("Error writing WAV: {}", path);
+            throw std::runtime_error(error);
+        }
+    }
+
+private:
+    static void SDLCALL postmix(void *udata, Uint8 *stream, int len)
+    {
+        auto *self = static_cast<OfflineAudioRenderer *>(udata);
+        if (self->done.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        // The device has been mixing silence since it was opened; the clock starts
+        // with the buffer after the one that applies the frame-0 commands.
+        if (!self->started)
+        {
+            self->apply_due(1);
+            self->started = true;
+            return;
+        }
+
+        Uint64 frames = static_cast<Uint64>(len / self->frame_bytes);
+        Uint64 keep = std::min(frames, self->total_frames - self->clock);
+        std::memcpy(self->samples.data() + self->clock * self->frame_bytes, stream,
+                    keep * self->frame_bytes);
+        self->clock += keep;
+        self->apply_due(self->clock);
+
+        if (self->clock == self->total_frames)
+        {
+            self->done.store(true, std::memory_order_release);
+        }
+    }
+
+    // Applies every command scheduled before `frame`.
+    void apply_due(Uint64 frame)
+    {
+        while (this->next_command < this->script.size() && this->script[this->next_command].frame < frame)
+        {
+            AudioCommandQueue::apply(this->script[this->next_command].command);
+            ++this->next_command;
+        }
+    }
+
+    std::vector<ScriptedCommand> script;
+    Uint64 total_frames;
+    int frequency{0};
+    Uint16 format{0};
+    int channels{0};
+    int frame_bytes{0};
+    std::vector<Uint8> samples;
+    Uint64 clock{0};
+    std::size_t next_command{0};
+    bool started{false};
+    std::atomic<bool> done{false};
+};
@@ -0,0 +1,380 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "camera.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PARTICLES_SSE2 1
+#endif
+
+struct ColorKey
+{
+    float t;
+    SDL_Color color;
+};
+
+struct SizeKey
+{
+    float t;
+    float size;
+};
+
+struct EmitterDesc
+{
+    float rate;              // particles per second
+    float lifetime_min;      // seconds
+    float lifetime_max;
+    float speed_min;         // pixels per second
+    float speed_max;
+    float direction;         // radians, 0 = +x, screen y grows downwards
+    float spread;            // half-angle of the velocity cone, radians
+    std::vector<ColorKey> colors;
+    std::vector<SizeKey> sizes;
+};
+
+// Colour and size over normalised age, sampled at 32 even steps.
+struct ParticleCurve
+{
+    static constexpr int steps = 32;
+
+    SDL_Color color[steps];
+    float size[steps];
+};
+
+// What drawing needs from a ParticleSystem, copied out so another thread can draw it.
+struct ParticleSnapshot
+{
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<float> ages;
+    std::vector<Uint16> owners;
+    std::vector<ParticleCurve> curves;
+
+    std::size_t size() const { return this->ages.size(); }
+};
+
+/*
+Particles with emitters, updated over SoA arrays and drawn (through
+ParticleGeometry) as one SDL_RenderGeometry call.
+
+Each particle is position, velocity, normalised age t in [0, 1) and the
+reciprocal of its lifetime, so aging is one multiply-add like the motion.
+The update is four particles per SSE2 step; dead ones (t >= 1) are swap-
+removed afterwards. Colour and size curves are baked into small per-emitter
+tables indexed by t when the vertices are built.
+*/
+class ParticleSystem
+{
+public:
+    explicit ParticleSystem(Uint32 seed = 1, float gravity = 0.0f) : rng_state{seed | 1u}, gravity{gravity} {}
+
+    int add_emitter(const EmitterDesc &desc)
+    {
+        Emitter emitter{desc, 0.0f, 0.0f, 0.0f, false};
+        ParticleCurve curve;
+        for (int i = 0; i < ParticleCurve::steps; ++i)
+        {
+            float t = static_cast<float>(i) / (ParticleCurve::steps - 1);
+            curve.color[i] = sample_color(desc.colors, t);
+            curve.size[i] = sample_size(desc.sizes, t);
+        }
+        this->emitters.push_back(std::move(emitter));
+        this->curves.push_back(curve);
+        return static_cast<int>(this->emitters.size() - 1);
+    }
+
+    void move_emitter(int id, float x, float y)
+    {
+        this->emitters[id].x = x;
+        this->emitters[id].y = y;
+    }
+
+    void set_active(int id, bool active) { this->emitters[id].active = active; }
+    bool active(int id) const { return this->emitters[id].active; }
+
+    void burst(int id, int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            this->emit(id);
+        }
+    }
+
+    void reserve(std::size_t capacity)
+    {
+        for (auto *field : {&this->xs, &this->ys, &this->xvels, &this->yvels, &this->ages, &this->age_rates})
+        {
+            field->reserve(capacity);
+        }
+        this->owners.reserve(capacity);
+    }
+
+    void update(float dt)
+    {
+        for (std::size_t id = 0; id < this->emitters.size(); ++id)
+        {
+            Emitter &emitter = this->emitters[id];
+            if (!emitter.active)
+            {
+                emitter.pending = 0.0f;
+                continue;
+            }
+            emitter.pending += emitter.desc.rate * dt;
+            int count = static_cast<int>(emitter.pending);
+            emitter.pending -= static_cast<float>(count);
+            this->burst(static_cast<int>(id), count);
+        }
+
+        this->integrate(dt);
+
+        std::size_t i = 0;
+        while (i < this->ages.size())
+        {
+            if (this->ages[i] < 1.0f)
+            {
+                ++i;
+                continue;
+            }
+            this->xs[i] = this->xs.back();
+            this->ys[i] = this->ys.back();
+            this->xvels[i] = this->xvels.back();
+            this->yvels[i] = this->yvels.back();
+            this->ages[i] = this->ages.back();
+            this->age_rates[i] = this->age_rates.back();
+            this->owners[i] = this->owners.back();
+            for (auto *field : {&this->xs, &this->ys, &this->xvels, &this->yvels, &this->ages, &this->age_rates})
+            {
+                field->pop_back();
+            }
+            this->owners.pop_back();
+        }
+    }
+
+    // Buffers keep their capacity, so a reused snapshot stops allocating once warm.
+    void snapshot(ParticleSnapshot &out) const
+    {
+        out.xs.assign(this->xs.begin(), this->xs.end());
+        out.ys.assign(this->ys.begin(), this->ys.end());
+        out.ages.assign(this->ages.begin(), this->ages.end());
+        out.owners.assign(this->owners.begin(), this->owners.end());
+        out.curves.assign(this->curves.begin(), this->curves.end());
+    }
+
+    const std::vector<ParticleCurve> &emitter_curves() const { return this->curves; }
+    const float *x() const { return this->xs.data(); }
+    const float *y() const { return this->ys.data(); }
+    const float *age() const { return this->ages.data(); }
+    const Uint16 *owner() const { return this->owners.data(); }
+
+    std::size_t size() const { return this->ages.size(); }
+
+private:
+    struct Emitter
+    {
+        EmitterDesc desc;
+        float x;
+        float y;
+        float pending;
+        bool active;
+    };
+
+    static SDL_Color sample_color(const std::vector<ColorKey> &keys, float t)
+    {
+        if (keys.empty())
+        {
+            return {255, 255, 255, 255};
+        }
+        if (t <= keys.front().t)
+        {
+            return keys.front().color;
+        }
+        for (std::size_t k = 1; k < keys.size(); ++k)
+        {
+            if (t <= keys[k].t)
+            {
+                const ColorKey &a = keys[k - 1];
+                const ColorKey &b = keys[k];
+                float f = (t - a.t) / std::max(b.t - a.t, 1e-6f);
+                auto mix = [f](Uint8 from, Uint8 to) { return static_cast<Uint8>(from + (to - from) * f + 0.5f); };
+                return {mix(a.color.r, b.color.r), mix(a.color.g, b.color.g), mix(a.color.b, b.color.b),
+                        mix(a.color.a, b.color.a)};
+            }
+        }
+        return keys.back().color;
+    }
+
+    static float sample_size(const std::vector<SizeKey> &keys, float t)
+    {
+        if (keys.empty())
+        {
+            return 2.0f;
+        }
+        if (t <= keys.front().t)
+        {
+            return keys.front().size;
+        }
+        for (std::size_t k = 1; k < keys.size(); ++k)
+        {
+            if (t <= keys[k].t)
+            {
+                float f = (t - keys[k - 1].t) / std::max(keys[k].t - keys[k - 1].t, 1e-6f);
+                return keys[k - 1].size + (keys[k].size - keys[k - 1].size) * f;
+            }
+        }
+        return keys.back().size;
+    }
+
+    // xorshift32: particles need plenty of cheap numbers, and the sequence must be reproducible.
+    float random01()
+    {
+        this->rng_state ^= this->rng_state << 13;
+        this->rng_state ^= this->rng_state >> 17;
+        this->rng_state ^= this->rng_state << 5;
+        return static_cast<float>(this->rng_state >> 8) * (1.0f / 16777216.0f);
+    }
+
+    float random_range(float lo, float hi) { return lo + (hi - lo) * this->random01(); }
+
+    void emit(int id)
+    {
+        const Emitter &emitter = this->emitters[id];
+        const EmitterDesc &desc = emitter.desc;
+        float angle = desc.direction + this->random_range(-desc.spread, desc.spread);
+        float speed = this->random_range(desc.speed_min, desc.speed_max);
+        float lifetime = std::max(this->random_range(desc.lifetime_min, desc.lifetime_max), 1e-3f);
+
+        this->xs.push_back(emitter.x);
+        this->ys.push_back(emitter.y);
+        this->xvels.push_back(std::cos(angle) * speed);
+        this->yvels.push_back(std::sin(angle) * speed);
+        this->ages.push_back(0.0f);
+        this->age_rates.push_back(1.0f / lifetime);
+        this->owners.push_back(static_cast<Uint16>(id));
+    }
+
+    void integrate(float dt)
+    {
+        float *__restrict x = this->xs.data();
+        float *__restrict y = this->ys.data();
+        const float *xvel = this->xvels.data();
+        float *__restrict yvel = this->yvels.data();
+        float *__restrict age = this->ages.data();
+        const float *age_rate = this->age_rates.data();
+        std::size_t count = this->size();
+        std::size_t i = 0;
+
+#ifdef PARTICLES_SSE2
+        const __m128 step = _mm_set1_ps(dt);
+        const __m128 fall = _mm_set1_ps(this->gravity * dt);
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 vy = _mm_loadu_ps(yvel + i);
+            _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(_mm_loadu_ps(xvel + i), step)));
+            _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(vy, step)));
+            _mm_storeu_ps(yvel + i, _mm_add_ps(vy, fall));
+            _mm_storeu_ps(age + i, _mm_add_ps(_mm_loadu_ps(age + i), _mm_mul_ps(_mm_loadu_ps(age_rate + i), step)));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            x[i] += xvel[i] * dt;
+            y[i] += yvel[i] * dt;
+            yvel[i] += this->gravity * dt;
+            age[i] += age_rate[i] * dt;
+        }
+    }
+
+    Uint32 rng_state;
+    float gravity;
+    std::vector<Emitter> emitters;
+    std::vector<ParticleCurve> curves;
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<float> xvels;
+    std::vector<float> yvels;
+    std::vector<float> ages;
+    std::vector<float> age_rates;
+    std::vector<Uint16> owners;
+};
+
+// Vertex and index buffers for drawing particles as quads.
+class ParticleGeometry
+{
+public:
+    // Positions given to build() are world space seen through `camera`; nullptr means screen pixels.
+    void set_camera(const Camera *camera) { this->camera = camera; }
+
+    // Grows the buffers to `count` quads; indices only change when they grow.
+    void resize(std::size_t count)
+    {
+        this->count = count;
+        this->vertices.resize(count * 4);
+        for (std::size_t q = this->indices.size() / 6; q < count; ++q)
+        {
+            int v = static_cast<int>(q * 4);
+            for (int index : {v, v + 1, v + 2, v, v + 2, v + 3})
+            {
+                this->indices.push_back(index);
+            }
+        }
+    }
+
+    // Quads for particles [begin, end); disjoint ranges may be built on different threads.
+    void build(const float *x, const float *y, const float *age, const Uint16 *owner,
+               const std::vector<ParticleCurve> &curves, std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            const ParticleCurve &curve = curves[owner[i]];
+            int step = static_cast<int>(age[i] * (ParticleCurve::steps - 1));
+            SDL_Color color = curve.color[step];
+            float half = curve.size[step] * 0.5f;
+            SDL_FPoint p{x[i], y[i]};
+            if (this->camera)
+            {
+                p = this->camera->to_screen(p.x, p.y);
+                half *= this->camera->zoom();
+            }
+
+            SDL_Vertex *quad = &this->vertices[i * 4];
+            quad[0] = {{p.x - half, p.y - half}, color, {0.0f, 0.0f}};
+            quad[1] = {{p.x + half, p.y - half}, color, {1.0f, 0.0f}};
+            quad[2] = {{p.x + half, p.y + half}, color, {1.0f, 1.0f}};
+            quad[3] = {{p.x - half, p.y + half}, color, {0.0f, 1.0f}};
+        }
+    }
+
+    void build(const ParticleSnapshot &snapshot, std::size_t begin, std::size_t end)
+    {
+        this->build(snapshot.xs.data(), snapshot.ys.data(), snapshot.ages.data(), snapshot.owners.data(),
+                    snapshot.curves, begin, end);
+    }
+
+    void build(const ParticleSystem &system, std::size_t begin, std::size_t end)
+    {
+        this->build(system.x(), system.y(), system.age(), system.owner(), system.emitter_curves(), begin, end);
+    }
+
+    // One draw call for every quad.
+    int render(SDL_Renderer *renderer, SDL_Texture *texture = nullptr)
+    {
+        if (this->count == 0)
+        {
+            return 0;
+        }
+        return SDL_RenderGeometry(renderer, texture, this->vertices.data(), static_cast<int>(this->count * 4),
+                                  this->indices.data(), static_cast<int>(this->count * 6));
+    }
+
+private:
+    std::size_t count{0};
+    const Camera *camera{nullptr};
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+};
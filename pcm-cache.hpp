@@ -0,0 +1,365 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "resampler.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+Disk cache of sound effects already decoded and resampled to the device format.
+
+cache/pcm/<source hash>-<freq>-<format>-<channels>-<resampler>.pcm
+  PcmHeader (32 bytes)
+  raw device-format samples, ready for Mix_QuickLoad_RAW
+*/
+
+// Read-only memory mapping of a whole file.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile() { this->close(); }
+
+    bool open(const std::filesystem::path &path)
+    {
+        this->close();
+#ifdef _WIN32
+        this->file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                 OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (this->file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(this->file, &file_size) || file_size.QuadPart == 0)
+        {
+            this->close();
+            return false;
+        }
+        this->mapping = CreateFileMappingW(this->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!this->mapping)
+        {
+            this->close();
+            return false;
+        }
+        this->bytes = static_cast<const Uint8 *>(MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0));
+        this->length = static_cast<std::size_t>(file_size.QuadPart);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) || st.st_size == 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        void *view = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED)
+        {
+            return false;
+        }
+        this->bytes = static_cast<const Uint8 *>(view);
+        this->length = static_cast<std::size_t>(st.st_size);
+#endif
+        if (!this->bytes)
+        {
+            this->close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (this->bytes)
+        {
+            UnmapViewOfFile(this->bytes);
+        }
+        if (this->mapping)
+        {
+            CloseHandle(this->mapping);
+        }
+        if (this->file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(this->file);
+        }
+        this->mapping = nullptr;
+        this->file = INVALID_HANDLE_VALUE;
+#else
+        if (this->bytes)
+        {
+            munmap(const_cast<Uint8 *>(this->bytes), this->length);
+        }
+#endif
+        this->bytes = nullptr;
+        this->length = 0;
+    }
+
+    const Uint8 *data() const { return this->bytes; }
+    std::size_t size() const { return this->length; }
+
+private:
+    const Uint8 *bytes{nullptr};
+    std::size_t length{0};
+#ifdef _WIN32
+    HANDLE file{INVALID_HANDLE_VALUE};
+    HANDLE mapping{nullptr};
+#endif
+};
+
+class PcmCache
+{
+public:
+    using Chunk = std::unique_ptr<Mix_Chunk, decltype(&Mix_FreeChunk)>;
+
+    explicit PcmCache(std::filesystem::path dir) : dir{std::move(dir)} {}
+
+    // Needs an open audio device. The cache must outlive every chunk it returns,
+    // since warm chunks point straight into its mappings.
+    // WAV sources are resampled by Resampler at `quality`; everything else is
+    // decoded and converted by Mix_LoadWAV.
+    Chunk load(const std::string &path, ResampleQuality quality = Resampler::default_quality())
+    {
+        std::vector<Uint8> source = read_file(path);
+        if (source.empty())
+        {
+            auto error = std::format("Error reading sound file: {}", path);
+            throw std::runtime_error(error);
+        }
+
+        PcmHeader want{};
+        std::memcpy(want.magic, "PCM1", 4);
+        want.source_hash = fnv1a(source.data(), source.size());
+        int channels = 0;
+        if (!Mix_QuerySpec(&want.frequency, &want.format, &channels))
+        {
+            auto error = std::format("Error querying audio device: {}", Mix_GetError());
+            throw std::runtime_error(error);
+        }
+        want.channels = static_cast<Uint16>(channels);
+
+        bool wav = is_wav(path);
+        want.resampler = wav ? static_cast<Uint8>(quality) : sdl_resampler;
+
+        auto entry = this->dir / std::format("{:016x}-{}-{:04x}-{}-{}.pcm", want.source_hash, want.frequency,
+                                             want.format, want.channels, wav ? to_string(quality) : "sdl");
+
+        if (Chunk chunk = this->load_cached(entry, want))
+        {
+            ++this->hit_count;
+            return chunk;
+        }
+
+        // Cold path: decode and convert, then store the device-format samples.
+        Chunk chunk{nullptr, Mix_FreeChunk};
+        if (wav)
+        {
+            chunk = resample_wav(source, want, quality);
+        }
+        else
+        {
+            SDL_RWops *rw = SDL_RWFromConstMem(source.data(), static_cast<int>(source.size()));
+            chunk.reset(Mix_LoadWAV_RW(rw, 1));
+        }
+        if (!chunk)
+        {
+            auto error = std::format("Error loading Chunk: {}", Mix_GetError());
+            throw std::runtime_error(error);
+        }
+        ++this->miss_count;
+
+        want.length = chunk->alen;
+        this->store(entry, want, chunk->abuf);
+        return chunk;
+    }
+
+    int hits() const { return this->hit_count; }
+    int misses() const { return this->miss_count; }
+
+private:
+    struct PcmHeader
+    {
+        char magic[4];
+        int frequency;
+        Uint64 source_hash;
+        Uint16 format;
+        Uint16 channels;
+        Uint32 length;
+        Uint8 resampler;
+        Uint8 reserved[7];
+    };
+    static_assert(sizeof(PcmHeader) == 32);
+
+    static constexpr Uint8 sdl_resampler = 0xff;
+
+    static bool is_wav(const std::filesystem::path &path)
+    {
+        auto ext = path.extension().string();
+        return ext.size() == 4 && SDL_strcasecmp(ext.c_str(), ".wav") == 0;
+    }
+
+    // Converts sample format and channel layout only; both rates are `rate`.
+    static std::vector<Uint8> convert(const Uint8 *data, std::size_t len, SDL_AudioFormat from, Uint8 from_channels,
+                                      SDL_AudioFormat to, Uint8 to_channels, int rate)
+    {
+        SDL_AudioCVT cvt;
+        int needed = SDL_BuildAudioCVT(&cvt, from, from_channels, rate, to, to_channels, rate);
+        if (needed < 0)
+        {
+            auto error = std::format("Error building audio conversion: {}", SDL_GetError());
+            throw std::runtime_error(error);
+        }
+
+        std::vector<Uint8> buffer(len * static_cast<std::size_t>(needed ? cvt.len_mult : 1));
+        std::memcpy(buffer.data(), data, len);
+        if (!needed)
+        {
+            return buffer;
+        }
+        cvt.buf = buffer.data();
+        cvt.len = static_cast<int>(len);
+        if (SDL_ConvertAudio(&cvt))
+        {
+            auto error = std::format("Error converting audio: {}", SDL_GetError());
+            throw std::runtime_error(error);
+        }
+        buffer.resize(static_cast<std::size_t>(cvt.len_cvt));
+        return buffer;
+    }
+
+    // SDL's converter only touches format and channels here; the rate change is ours.
+    static Chunk resample_wav(const std::vector<Uint8> &source, const PcmHeader &want, ResampleQuality quality)
+    {
+        SDL_AudioSpec spec;
+        Uint8 *wav_buf = nullptr;
+        Uint32 wav_len = 0;
+        SDL_RWops *rw = SDL_RWFromConstMem(source.data(), static_cast<int>(source.size()));
+        if (!SDL_LoadWAV_RW(rw, 1, &spec, &wav_buf, &wav_len))
+        {
+            auto error = std::format("Error loading WAV: {}", SDL_GetError());
+            throw std::runtime_error(error);
+        }
+        std::unique_ptr<Uint8, decltype(&SDL_FreeWAV)> wav{wav_buf, SDL_FreeWAV};
+
+        Uint8 channels = static_cast<Uint8>(want.channels);
+        auto floats = convert(wav.get(), wav_len, spec.format, spec.channels, AUDIO_F32SYS, channels, spec.freq);
+        std::vector<float> resampled;
+        Resampler::process(reinterpret_cast<const float *>(floats.data()), floats.size() / sizeof(float) / channels,
+                           channels, spec.freq, want.frequency, quality, resampled);
+        auto samples = convert(reinterpret_cast<const Uint8 *>(resampled.data()), resampled.size() * sizeof(float),
+                               AUDIO_F32SYS, channels, want.format, channels, want.frequency);
+
+        // Laid out the way SDL_mixer allocates its own chunks, so Mix_FreeChunk can free it.
+        auto *chunk = static_cast<Mix_Chunk *>(SDL_malloc(sizeof(Mix_Chunk)));
+        auto *abuf = static_cast<Uint8 *>(SDL_malloc(samples.size()));
+        if (!chunk || !abuf)
+        {
+            SDL_free(chunk);
+            SDL_free(abuf);
+            throw std::runtime_error("Error allocating Chunk");
+        }
+        std::memcpy(abuf, samples.data(), samples.size());
+        chunk->allocated = 1;
+        chunk->abuf = abuf;
+        chunk->alen = static_cast<Uint32>(samples.size());
+        chunk->volume = MIX_MAX_VOLUME;
+        return {chunk, Mix_FreeChunk};
+    }
+
+    static std::vector<Uint8> read_file(const std::filesystem::path &path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    }
+
+    static Uint64 fnv1a(const Uint8 *data, std::size_t size)
+    {
+        Uint64 hash = 14695981039346656037ull;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ data[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    Chunk load_cached(const std::filesystem::path &entry, const PcmHeader &want)
+    {
+        auto mapped = std::make_unique<MappedFile>();
+        if (!mapped->open(entry) || mapped->size() < sizeof(PcmHeader))
+        {
+            return {nullptr, Mix_FreeChunk};
+        }
+
+        PcmHeader have;
+        std::memcpy(&have, mapped->data(), sizeof(have));
+        if (std::memcmp(have.magic, want.magic, 4) || have.source_hash != want.source_hash ||
+            have.frequency != want.frequency || have.format != want.format ||
+            have.channels != want.channels || have.resampler != want.resampler || mapped->size() != sizeof(have) + have.length)
+        {
+            return {nullptr, Mix_FreeChunk};
+        }
+
+        // SDL_mixer only reads chunk samples, so the read-only view is safe here.
+        Uint8 *samples = const_cast<Uint8 *>(mapped->data()) + sizeof(have);
+        Chunk chunk{Mix_QuickLoad_RAW(samples, have.length), Mix_FreeChunk};
+        if (chunk)
+        {
+            this->mappings.push_back(std::move(mapped));
+        }
+        return chunk;
+    }
+
+    // A failed store only costs the next run another decode.
+    void store(const std::filesystem::path &entry, const PcmHeader &header, const Uint8 *samples)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(this->dir, ec);
+
+        auto tmp = entry;
+        tmp += ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char *>(samples), header.length);
+            if (!out)
+            {
+                out.close();
+                std::filesystem::remove(tmp, ec);
+                return;
+            }
+        }
+        std::filesystem::rename(tmp, entry, ec);
+    }
+
+    std::filesystem::path dir;
+    std::vector<std::unique_ptr<MappedFile>> mappings;
+    int hit_count{0};
+    int miss_count{0};
+};
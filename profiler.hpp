@@ -0,0 +1,108 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cstddef>
+#include <format>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+/*
+Per-frame counters and timers, summarised on exit.
+
+Anything can add to a named counter during a frame; end_frame() folds the
+frame's values into running totals and maxima. Names are looked up linearly,
+which is cheaper than hashing for the dozen or so a frame records. Times are
+counters too, in milliseconds, fed by Profiler::Scope.
+*/
+class Profiler
+{
+public:
+    // Adds the lifetime of the scope, in milliseconds, to `name`.
+    class Scope
+    {
+    public:
+        Scope(Profiler &profiler, std::string_view name)
+            : profiler{profiler}, name{name}, start{SDL_GetPerformanceCounter()} {}
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+        ~Scope()
+        {
+            double ms = static_cast<double>(SDL_GetPerformanceCounter() - this->start) * 1e3 /
+                        static_cast<double>(SDL_GetPerformanceFrequency());
+            this->profiler.add(this->name, ms);
+        }
+
+    private:
+        Profiler &profiler;
+        std::string_view name;
+        Uint64 start;
+    };
+
+    struct Counter
+    {
+        std::string_view name;
+        double frame;
+        double total;
+        double max;
+    };
+
+    // `name` must outlive the profiler; string literals are the intended use.
+    void add(std::string_view name, double value) { this->find(name).frame += value; }
+
+    void end_frame()
+    {
+        for (Counter &counter : this->counters)
+        {
+            counter.total += counter.frame;
+            counter.max = std::max(counter.max, counter.frame);
+            counter.frame = 0.0;
+        }
+        ++this->frame_count;
+    }
+
+    Uint64 frames() const { return this->frame_count; }
+
+    // Average per frame so far, 0 for unknown names.
+    double average(std::string_view name) const
+    {
+        for (const Counter &counter : this->counters)
+        {
+            if (counter.name == name)
+            {
+                return counter.total / static_cast<double>(std::max<Uint64>(this->frame_count, 1));
+            }
+        }
+        return 0.0;
+    }
+
+    const std::vector<Counter> &all() const { return this->counters; }
+
+    void report(std::ostream &out) const
+    {
+        double frames = static_cast<double>(std::max<Uint64>(this->frame_count, 1));
+        out << std::format("profile over {} frames (avg/frame, max):", this->frame_count) << std::endl;
+        for (const Counter &counter : this->counters)
+        {
+            out << std::format("  {:<24} {:>12.3f} {:>12.3f}", counter.name, counter.total / frames, counter.max)
+                << std::endl;
+        }
+    }
+
+private:
+    Counter &find(std::string_view name)
+    {
+        for (Counter &counter : this->counters)
+        {
+            if (counter.name == name)
+            {
+                return counter;
+            }
+        }
+        return this->counters.emplace_back(Counter{name, 0.0, 0.0, 0.0});
+    }
+
+    std::vector<Counter> counters;
+    Uint64 frame_count{0};
+};
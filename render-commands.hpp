@@ -0,0 +1,320 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <cstddef>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "camera.hpp"
+
+/*
+Draw commands collected over a frame, sorted, then executed in batches.
+
+Every command gets a 64-bit key, most significant first:
+
+    layer 8 | depth 16 | blend 4 | texture 16 | sequence 20
+
+so layers and depths keep their order, and inside one (layer, depth) the
+commands group by blend mode and texture. The submission sequence breaks ties,
+keeping the sort stable. Keys are sorted with an LSD radix sort, 8 bits per
+pass, skipping bytes that are equal in every key.
+
+Execution merges each run of commands with the same state: textured copies
+become one SDL_RenderGeometry call, solid rectangles one SDL_RenderFillRectsF
+per colour.
+
+With a camera set, destinations are world space and are transformed as they
+are submitted; without one they are screen pixels.
+*/
+class RenderCommandBuffer
+{
+public:
+    struct Stats
+    {
+        std::size_t commands;
+        std::size_t state_changes_submitted;
+        std::size_t state_changes_sorted;
+        std::size_t draw_calls;
+    };
+
+    // Applies to the copy() and fill() calls that follow; nullptr goes back to screen space.
+    void set_camera(const Camera *camera) { this->camera = camera; }
+
+    void copy(Uint8 layer, Uint16 depth, SDL_Texture *texture, const SDL_Rect *src, const SDL_FRect &dst)
+    {
+        Command command{};
+        command.texture = texture;
+        command.dst = this->camera ? this->camera->to_screen(dst) : dst;
+        command.color = {255, 255, 255, 255};
+        command.has_src = src != nullptr;
+        if (src)
+        {
+            command.src = *src;
+        }
+        SDL_GetTextureBlendMode(texture, &command.blend);
+        this->submit(layer, depth, command);
+    }
+
+    void fill(Uint8 layer, Uint16 depth, const SDL_FRect &rect, SDL_Color color,
+              SDL_BlendMode blend = SDL_BLENDMODE_BLEND)
+    {
+        Command command{};
+        command.dst = this->camera ? this->camera->to_screen(rect) : rect;
+        command.color = color;
+        command.blend = blend;
+        this->submit(layer, depth, command);
+    }
+
+    // Sorts, draws and clears the buffer.
+    void flush(SDL_Renderer *renderer)
+    {
+        this->last = Stats{this->commands.size(), this->count_state_changes(false), 0, 0};
+        this->sort();
+        this->last.state_changes_sorted = this->count_state_changes(true);
+
+        Uint8 r, g, b, a;
+        SDL_BlendMode draw_blend;
+        SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+        SDL_GetRenderDrawBlendMode(renderer, &draw_blend);
+
+        std::size_t i = 0;
+        while (i < this->order.size())
+        {
+            const Command &first = this->commands[this->order[i]];
+            std::size_t end = i + 1;
+            while (end < this->order.size() && same_state(first, this->commands[this->order[end]]))
+            {
+                ++end;
+            }
+            if (first.texture)
+            {
+                this->draw_copies(renderer, i, end);
+            }
+            else
+            {
+                this->draw_fills(renderer, i, end);
+            }
+            ++this->last.draw_calls;
+            i = end;
+        }
+
+        SDL_SetRenderDrawColor(renderer, r, g, b, a);
+        SDL_SetRenderDrawBlendMode(renderer, draw_blend);
+        this->commands.clear();
+        this->keys.clear();
+    }
+
+    // Drops the cached id and size of a texture that is about to be destroyed; the id is reused.
+    void forget(SDL_Texture *texture)
+    {
+        auto found = this->textures.find(texture);
+        if (found != this->textures.end())
+        {
+            this->free_ids.push_back(found->second.id);
+            this->textures.erase(found);
+        }
+    }
+
+    const Stats &stats() const { return this->last; }
+
+private:
+    struct Command
+    {
+        SDL_Texture *texture;
+        SDL_Rect src;
+        SDL_FRect dst;
+        SDL_Color color;
+        SDL_BlendMode blend;
+        bool has_src;
+    };
+
+    struct TextureInfo
+    {
+        Uint16 id;
+        float width;
+        float height;
+    };
+
+    static bool same_state(const Command &a, const Command &b)
+    {
+        if (a.texture != b.texture || a.blend != b.blend)
+        {
+            return false;
+        }
+        return a.texture || std::memcmp(&a.color, &b.color, sizeof(SDL_Color)) == 0;
+    }
+
+    static Uint64 blend_bits(SDL_BlendMode blend)
+    {
+        switch (blend)
+        {
+        case SDL_BLENDMODE_NONE:
+            return 0;
+        case SDL_BLENDMODE_BLEND:
+            return 1;
+        case SDL_BLENDMODE_ADD:
+            return 2;
+        case SDL_BLENDMODE_MOD:
+            return 3;
+        case SDL_BLENDMODE_MUL:
+            return 4;
+        default:
+            return 15;
+        }
+    }
+
+    /*
+    Texture ids start at 1; 0 is "no texture". Ids and sizes are remembered
+    across frames, and ids freed by forget() are handed out again first, so
+    two live textures never share one. Only past 65535 live textures does
+    next_id wrap (skipping 0) and collide; that costs batching, not
+    correctness, since same_state() compares texture pointers.
+    */
+    const TextureInfo &texture_info(SDL_Texture *texture)
+    {
+        auto found = this->textures.find(texture);
+        if (found != this->textures.end())
+        {
+            return found->second;
+        }
+        Uint16 id = 0;
+        if (!this->free_ids.empty())
+        {
+            id = this->free_ids.back();
+            this->free_ids.pop_back();
+        }
+        else
+        {
+            id = this->next_id++;
+            if (this->next_id == 0)
+            {
+                this->next_id = 1;
+            }
+        }
+        int w = 1, h = 1;
+        SDL_QueryTexture(texture, nullptr, nullptr, &w, &h);
+        TextureInfo info{id, static_cast<float>(w), static_cast<float>(h)};
+        return this->textures.emplace(texture, info).first->second;
+    }
+
+    void submit(Uint8 layer, Uint16 depth, const Command &command)
+    {
+        Uint64 texture = command.texture ? this->texture_info(command.texture).id : 0;
+        Uint64 sequence = this->commands.size() & 0xfffff;
+        Uint64 key = Uint64{layer} << 56 | Uint64{depth} << 40 | blend_bits(command.blend) << 36 |
+                     (texture & 0xffff) << 20 | sequence;
+        this->keys.push_back(key);
+        this->commands.push_back(command);
+    }
+
+    void sort()
+    {
+        std::size_t count = this->keys.size();
+        this->order.resize(count);
+        this->scratch_order.resize(count);
+        this->sorted_keys = this->keys;
+        this->scratch_keys.resize(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            this->order[i] = static_cast<Uint32>(i);
+        }
+
+        for (int shift = 0; shift < 64; shift += 8)
+        {
+            std::size_t counts[257] = {};
+            for (Uint64 key : this->sorted_keys)
+            {
+                ++counts[((key >> shift) & 0xff) + 1];
+            }
+            if (counts[((this->sorted_keys.empty() ? 0 : this->sorted_keys[0] >> shift) & 0xff) + 1] == count)
+            {
+                continue;
+            }
+            for (int b = 0; b < 256; ++b)
+            {
+                counts[b + 1] += counts[b];
+            }
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                std::size_t to = counts[(this->sorted_keys[i] >> shift) & 0xff]++;
+                this->scratch_keys[to] = this->sorted_keys[i];
+                this->scratch_order[to] = this->order[i];
+            }
+            this->sorted_keys.swap(this->scratch_keys);
+            this->order.swap(this->scratch_order);
+        }
+    }
+
+    // Texture or blend changes between neighbours, in submission order or after sorting.
+    std::size_t count_state_changes(bool sorted) const
+    {
+        std::size_t changes = 0;
+        const Command *previous = nullptr;
+        for (std::size_t i = 0; i < this->commands.size(); ++i)
+        {
+            const Command &command = this->commands[sorted ? this->order[i] : i];
+            changes += !previous || previous->texture != command.texture || previous->blend != command.blend;
+            previous = &command;
+        }
+        return changes;
+    }
+
+    void draw_copies(SDL_Renderer *renderer, std::size_t begin, std::size_t end)
+    {
+        const Command &first = this->commands[this->order[begin]];
+        const TextureInfo &info = this->texture_info(first.texture);
+        this->vertices.clear();
+        this->indices.clear();
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            const Command &command = this->commands[this->order[i]];
+            SDL_FRect uv{0.0f, 0.0f, 1.0f, 1.0f};
+            if (command.has_src)
+            {
+                uv = {command.src.x / info.width, command.src.y / info.height, command.src.w / info.width,
+                      command.src.h / info.height};
+            }
+            const SDL_FRect &d = command.dst;
+            int v = static_cast<int>(this->vertices.size());
+            this->vertices.push_back({{d.x, d.y}, command.color, {uv.x, uv.y}});
+            this->vertices.push_back({{d.x + d.w, d.y}, command.color, {uv.x + uv.w, uv.y}});
+            this->vertices.push_back({{d.x + d.w, d.y + d.h}, command.color, {uv.x + uv.w, uv.y + uv.h}});
+            this->vertices.push_back({{d.x, d.y + d.h}, command.color, {uv.x, uv.y + uv.h}});
+            for (int index : {v, v + 1, v + 2, v, v + 2, v + 3})
+            {
+                this->indices.push_back(index);
+            }
+        }
+        SDL_RenderGeometry(renderer, first.texture, this->vertices.data(), static_cast<int>(this->vertices.size()),
+                           this->indices.data(), static_cast<int>(this->indices.size()));
+    }
+
+    void draw_fills(SDL_Renderer *renderer, std::size_t begin, std::size_t end)
+    {
+        const Command &first = this->commands[this->order[begin]];
+        this->rects.clear();
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            this->rects.push_back(this->commands[this->order[i]].dst);
+        }
+        SDL_SetRenderDrawBlendMode(renderer, first.blend);
+        SDL_SetRenderDrawColor(renderer, first.color.r, first.color.g, first.color.b, first.color.a);
+        SDL_RenderFillRectsF(renderer, this->rects.data(), static_cast<int>(this->rects.size()));
+    }
+
+    std::vector<Command> commands;
+    std::vector<Uint64> keys;
+    std::vector<Uint64> sorted_keys;
+    std::vector<Uint64> scratch_keys;
+    std::vector<Uint32> order;
+    std::vector<Uint32> scratch_order;
+    std::unordered_map<SDL_Texture *, TextureInfo> textures;
+    std::vector<Uint16> free_ids;
+    Uint16 next_id{1};
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+    std::vector<SDL_FRect> rects;
+    const Camera *camera{nullptr};
+    Stats last{};
+};
@@ -0,0 +1,285 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+Picks the fastest render driver for a window and remembers it.
+
+probe() creates a renderer with every driver SDL_GetRenderDriverInfo lists,
+software included, and times a short synthetic frame on each: one batched
+SDL_RenderGeometry of textured quads plus a batch of blended fills, the two
+call shapes the game issues. The last frame ends with a one-pixel
+SDL_RenderReadPixels so queued GPU work is counted.
+
+The winner goes to a two-line text file:
+
+    sdl <version> drivers <name,name,...>
+    <driver name>
+
+and create() trusts it for as long as the SDL version and driver list match.
+A cached driver that no longer creates, or no cache at all, runs the probe;
+if every driver fails there, SDL's own choice and then the software renderer
+are tried before giving up.
+*/
+class RenderProbe
+{
+public:
+    struct Result
+    {
+        std::string driver;
+        Uint32 flags;
+        bool created;
+        double ms_per_frame;
+        std::string error;
+    };
+
+    explicit RenderProbe(std::filesystem::path cache_file, int frames = 30)
+        : cache_file{std::move(cache_file)}, frames{frames} {}
+
+    // Never returns nullptr; throws if not even the software renderer works.
+    SDL_Renderer *create(SDL_Window *window, bool force_probe = false)
+    {
+        std::string signature = driver_signature();
+        if (!force_probe)
+        {
+            std::string cached = this->read_cache(signature);
+            int index = driver_index(cached);
+            if (index >= 0)
+            {
+                if (SDL_Renderer *renderer = SDL_CreateRenderer(window, index, 0))
+                {
+                    this->chosen = cached;
+                    this->source = "cache";
+                    return renderer;
+                }
+            }
+        }
+
+        this->probe(window);
+        const Result *best = nullptr;
+        for (const Result &result : this->results)
+        {
+            if (result.created && (!best || result.ms_per_frame < best->ms_per_frame))
+            {
+                best = &result;
+            }
+        }
+        if (best)
+        {
+            if (SDL_Renderer *renderer = SDL_CreateRenderer(window, driver_index(best->driver), 0))
+            {
+                this->chosen = best->driver;
+                this->source = "probe";
+                this->write_cache(signature);
+                return renderer;
+            }
+        }
+
+        for (Uint32 flags : {Uint32{0}, Uint32{SDL_RENDERER_SOFTWARE}})
+        {
+            if (SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, flags))
+            {
+                SDL_RendererInfo info;
+                SDL_GetRendererInfo(renderer, &info);
+                this->chosen = info.name;
+                this->source = "fallback";
+                return renderer;
+            }
+        }
+        auto error = std::format("Failed to create renderer: {}", SDL_GetError());
+        throw std::runtime_error(error);
+    }
+
+    // Benchmarks every driver on `window`; all() then holds one result per driver.
+    void probe(SDL_Window *window)
+    {
+        this->results.clear();
+        for (int i = 0; i < SDL_GetNumRenderDrivers(); ++i)
+        {
+            SDL_RendererInfo info;
+            if (SDL_GetRenderDriverInfo(i, &info))
+            {
+                continue;
+            }
+            Result result{info.name, info.flags, false, 0.0, {}};
+            std::unique_ptr<SDL_Renderer, decltype(&SDL_DestroyRenderer)> renderer{SDL_CreateRenderer(window, i, 0),
+                                                                                   SDL_DestroyRenderer};
+            if (!renderer)
+            {
+                result.error = SDL_GetError();
+            }
+            else
+            {
+                result.created = this->time_frames(renderer.get(), result);
+            }
+            this->results.push_back(std::move(result));
+        }
+    }
+
+    const std::vector<Result> &all() const { return this->results; }
+    const std::string &driver() const { return this->chosen; }
+    // "cache", "probe" or "fallback".
+    const std::string &chosen_by() const { return this->source; }
+
+    void report(std::ostream &out) const
+    {
+        out << std::format("render driver: {} (from {})", this->chosen, this->source) << std::endl;
+        for (const Result &result : this->results)
+        {
+            if (result.created)
+            {
+                out << std::format("  {:<12} {:8.3f} ms/frame{}", result.driver, result.ms_per_frame,
+                                   result.driver == this->chosen ? "  <- chosen" : "")
+                    << std::endl;
+            }
+            else
+            {
+                out << std::format("  {:<12} unavailable: {}", result.driver, result.error) << std::endl;
+            }
+        }
+    }
+
+private:
+    static constexpr int quads = 2000;
+    static constexpr int fills = 500;
+    static constexpr int warmup = 3;
+
+    static int driver_index(const std::string &name)
+    {
+        for (int i = 0; !name.empty() && i < SDL_GetNumRenderDrivers(); ++i)
+        {
+            SDL_RendererInfo info;
+            if (!SDL_GetRenderDriverInfo(i, &info) && name == info.name)
+            {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // Changes whenever SDL is upgraded or the set of compiled-in drivers does.
+    static std::string driver_signature()
+    {
+        SDL_version version;
+        SDL_GetVersion(&version);
+        std::string names;
+        for (int i = 0; i < SDL_GetNumRenderDrivers(); ++i)
+        {
+            SDL_RendererInfo info;
+            if (!SDL_GetRenderDriverInfo(i, &info))
+            {
+                names += names.empty() ? info.name : std::format(",{}", info.name);
+            }
+        }
+        return std::format("sdl {}.{}.{} drivers {}", version.major, version.minor, version.patch, names);
+    }
+
+    bool time_frames(SDL_Renderer *renderer, Result &result)
+    {
+        constexpr int size = 32;
+        std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)> texture{
+            SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, size, size),
+            SDL_DestroyTexture};
+        if (!texture)
+        {
+            result.error = SDL_GetError();
+            return false;
+        }
+        std::vector<Uint32> pixels(size * size);
+        for (int i = 0; i < size * size; ++i)
+        {
+            pixels[i] = ((i / size + i) & 8) ? 0xffffffff : 0x80ff8040;
+        }
+        SDL_UpdateTexture(texture.get(), nullptr, pixels.data(), size * 4);
+        SDL_SetTextureBlendMode(texture.get(), SDL_BLENDMODE_BLEND);
+
+        int width = 0, height = 0;
+        SDL_GetRendererOutputSize(renderer, &width, &height);
+        std::vector<SDL_Vertex> vertices;
+        std::vector<int> indices;
+        std::vector<SDL_FRect> rects;
+        for (int q = 0; q < quads; ++q)
+        {
+            float x = static_cast<float>((q * 37) % std::max(width - size, 1));
+            float y = static_cast<float>((q * 91) % std::max(height - size, 1));
+            SDL_Color white{255, 255, 255, 255};
+            int v = static_cast<int>(vertices.size());
+            vertices.push_back({{x, y}, white, {0.0f, 0.0f}});
+            vertices.push_back({{x + size, y}, white, {1.0f, 0.0f}});
+            vertices.push_back({{x + size, y + size}, white, {1.0f, 1.0f}});
+            vertices.push_back({{x, y + size}, white, {0.0f, 1.0f}});
+            for (int index : {v, v + 1, v + 2, v, v + 2, v + 3})
+            {
+                indices.push_back(index);
+            }
+        }
+        for (int f = 0; f < fills; ++f)
+        {
+            rects.push_back({static_cast<float>((f * 53) % std::max(width - 8, 1)),
+                             static_cast<float>((f * 29) % std::max(height - 8, 1)), 8.0f, 8.0f});
+        }
+
+        Uint64 start = 0;
+        for (int frame = 0; frame < warmup + this->frames; ++frame)
+        {
+            if (frame == warmup)
+            {
+                start = SDL_GetPerformanceCounter();
+            }
+            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+            SDL_RenderClear(renderer);
+            if (SDL_RenderGeometry(renderer, texture.get(), vertices.data(), static_cast<int>(vertices.size()),
+                                   indices.data(), static_cast<int>(indices.size())))
+            {
+                result.error = SDL_GetError();
+                return false;
+            }
+            SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+            SDL_SetRenderDrawColor(renderer, 255, 220, 64, 160);
+            SDL_RenderFillRectsF(renderer, rects.data(), static_cast<int>(rects.size()));
+            SDL_RenderPresent(renderer);
+        }
+        Uint32 pixel = 0;
+        SDL_Rect one{0, 0, 1, 1};
+        SDL_RenderReadPixels(renderer, &one, SDL_PIXELFORMAT_ARGB8888, &pixel, 4);
+
+        result.ms_per_frame = static_cast<double>(SDL_GetPerformanceCounter() - start) * 1e3 /
+                              static_cast<double>(SDL_GetPerformanceFrequency()) / this->frames;
+        return true;
+    }
+
+    std::string read_cache(const std::string &signature) const
+    {
+        std::ifstream in(this->cache_file);
+        std::string have, name;
+        if (!std::getline(in, have) || have != signature || !std::getline(in, name))
+        {
+            return {};
+        }
+        return name;
+    }
+
+    // A cache that cannot be written only costs a probe on the next start.
+    void write_cache(const std::string &signature) const
+    {
+        std::error_code ignored;
+        std::filesystem::create_directories(this->cache_file.parent_path(), ignored);
+        std::ofstream out(this->cache_file, std::ios::trunc);
+        out << signature << '\n' << this->chosen << '\n';
+    }
+
+    std::filesystem::path cache_file;
+    int frames;
+    std::vector<Result> results;
+    std::string chosen;
+    std::string source;
+};
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RESAMPLER_SSE2 1
+#endif
+
+enum class ResampleQuality : Uint8
+{
+    Nearest,
+    Linear,
+    Sinc,
+};
+
+inline const char *to_string(ResampleQuality quality)
+{
+    switch (quality)
+    {
+    case ResampleQuality::Nearest:
+        return "nearest";
+    case ResampleQuality::Linear:
+        return "linear";
+    case ResampleQuality::Sinc:
+        return "sinc";
+    }
+    return "unknown";
+}
+
+/*
+Sample-rate conversion of interleaved float audio in three quality tiers.
+
+nearest  one load per output sample, audible aliasing
+linear   two taps, SSE2 blends four outputs at a time
+sinc     16-tap Blackman-windowed sinc from a 512-phase table, SSE2 dot products;
+         the cutoff follows the ratio so downsampling does not alias
+
+Positions are 32.32 fixed point, so long buffers do not drift.
+*/
+class Resampler
+{
+public:
+    static constexpr int sinc_taps = 16;
+    static constexpr int sinc_phase_bits = 9;
+    static constexpr int sinc_phases = 1 << sinc_phase_bits;
+
+    // Used by callers that do not ask for a tier per voice.
+    static ResampleQuality default_quality() { return global_quality; }
+    static void set_default_quality(ResampleQuality quality) { global_quality = quality; }
+
+    static std::size_t output_frames(std::size_t in_frames, int src_rate, int dst_rate)
+    {
+        return static_cast<std::size_t>((static_cast<Uint64>(in_frames) * dst_rate + src_rate - 1) / src_rate);
+    }
+
+    static void process(const float *in, std::size_t in_frames, int channels, int src_rate, int dst_rate,
+                        ResampleQuality quality, std::vector<float> &out)
+    {
+        std::size_t out_frames = output_frames(in_frames, src_rate, dst_rate);
+        out.assign(out_frames * channels, 0.0f);
+        if (!in_frames)
+        {
+            return;
+        }
+
+        Uint64 step = (static_cast<Uint64>(src_rate) << 32) / static_cast<Uint64>(dst_rate);
+        std::vector<float> table;
+        if (quality == ResampleQuality::Sinc)
+        {
+            build_sinc_table(std::min(1.0, static_cast<double>(dst_rate) / src_rate), table);
+        }
+
+        // Work per channel on contiguous samples, padded for the sinc taps.
+        constexpr std::size_t pad = sinc_taps;
+        std::vector<float> planar(in_frames + 2 * pad);
+        std::vector<float> result(out_frames);
+        for (int c = 0; c < channels; ++c)
+        {
+            for (std::size_t i = 0; i < in_frames; ++i)
+            {
+                planar[pad + i] = in[i * channels + c];
+            }
+            std::fill(planar.begin(), planar.begin() + pad, planar[pad]);
+            std::fill(planar.end() - pad, planar.end(), planar[pad + in_frames - 1]);
+
+            switch (quality)
+            {
+            case ResampleQuality::Nearest:
+                nearest(planar.data() + pad, in_frames, result.data(), out_frames, step);
+                break;
+            case ResampleQuality::Linear:
+                linear(planar.data() + pad, in_frames, result.data(), out_frames, step);
+                break;
+            case ResampleQuality::Sinc:
+                sinc(planar.data() + pad, result.data(), out_frames, step, table.data());
+                break;
+            }
+
+            for (std::size_t i = 0; i < out_frames; ++i)
+            {
+                out[i * channels + c] = result[i];
+            }
+        }
+    }
+
+private:
+    static constexpr double frac_scale = 1.0 / 4294967296.0;
+
+    // Not worth vectorizing: one unaligned load per output sample is all there is.
+    static void nearest(const float *in, std::size_t n, float *out, std::size_t m, Uint64 step)
+    {
+        Uint64 pos = 0;
+        for (std::size_t i = 0; i < m; ++i, pos += step)
+        {
+            std::size_t index = static_cast<std::size_t>((pos + 0x80000000ull) >> 32);
+            out[i] = in[std::min(index, n - 1)];
+        }
+    }
+
+    // Reads in[n] at the very end, which the caller's padding makes safe.
+    static void linear(const float *in, std::size_t n, float *out, std::size_t m, Uint64 step)
+    {
+        Uint64 pos = 0;
+        std::size_t i = 0;
+#ifdef RESAMPLER_SSE2
+        const __m128 scale = _mm_set1_ps(static_cast<float>(frac_scale));
+        for (; i + 4 <= m && ((pos + 3 * step) >> 32) < n; i += 4)
+        {
+            Uint64 p0 = pos, p1 = pos + step, p2 = pos + 2 * step, p3 = pos + 3 * step;
+            pos += 4 * step;
+            const float *x0 = in + (p0 >> 32), *x1 = in + (p1 >> 32), *x2 = in + (p2 >> 32), *x3 = in + (p3 >> 32);
+            __m128 a = _mm_setr_ps(x0[0], x1[0], x2[0], x3[0]);
+            __m128 b = _mm_setr_ps(x0[1], x1[1], x2[1], x3[1]);
+            // The low 32 bits are the fraction; convert them via signed ints, biased by 2^31.
+            __m128i frac = _mm_setr_epi32(static_cast<int>(p0 ^ 0x80000000u), static_cast<int>(p1 ^ 0x80000000u),
+                                          static_cast<int>(p2 ^ 0x80000000u), static_cast<int>(p3 ^ 0x80000000u));
+            __m128 t = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(frac), scale), _mm_set1_ps(0.5f));
+            _mm_storeu_ps(out + i, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t)));
+        }
+#endif
+        for (; i < m; ++i, pos += step)
+        {
+            std::size_t index = std::min(static_cast<std::size_t>(pos >> 32), n - 1);
+            float t = static_cast<float>((pos & 0xffffffffull) * frac_scale);
+            out[i] = in[index] + (in[index + 1] - in[index]) * t;
+        }
+    }
+
+    // `in` has sinc_taps samples of padding on both sides.
+    static void sinc(const float *in, float *out, std::size_t m, Uint64 step, const float *table)
+    {
+        constexpr int half = sinc_taps / 2;
+        Uint64 pos = 0;
+        for (std::size_t i = 0; i < m; ++i, pos += step)
+        {
+            const float *x = in + static_cast<std::ptrdiff_t>(pos >> 32) - (half - 1);
+            const float *h = table + ((pos & 0xffffffffull) >> (32 - sinc_phase_bits)) * sinc_taps;
+#ifdef RESAMPLER_SSE2
+            __m128 acc = _mm_mul_ps(_mm_loadu_ps(x), _mm_loadu_ps(h));
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(x + 4), _mm_loadu_ps(h + 4)));
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(x + 8), _mm_loadu_ps(h + 8)));
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(x + 12), _mm_loadu_ps(h + 12)));
+            acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+            acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+            out[i] = _mm_cvtss_f32(acc);
+#else
+            float sum = 0.0f;
+            for (int k = 0; k < sinc_taps; ++k)
+            {
+                sum += x[k] * h[k];
+            }
+            out[i] = sum;
+#endif
+        }
+    }
+
+    static void build_sinc_table(double cutoff, std::vector<float> &table)
+    {
+        constexpr double pi = 3.14159265358979323846;
+        constexpr int half = sinc_taps / 2;
+        table.assign(sinc_phases * sinc_taps, 0.0f);
+
+        for (int phase = 0; phase < sinc_phases; ++phase)
+        {
+            double frac = static_cast<double>(phase) / sinc_phases;
+            double sum = 0.0;
+            double taps[sinc_taps];
+            for (int k = 0; k < sinc_taps; ++k)
+            {
+                double d = k - (half - 1) - frac;
+                double x = pi * cutoff * d;
+                double s = std::abs(x) < 1e-9 ? 1.0 : std::sin(x) / x;
+                double w = 0.42 + 0.5 * std::cos(pi * d / half) + 0.08 * std::cos(2.0 * pi * d / half);
+                taps[k] = std::abs(d) >= half ? 0.0 : s * w;
+                sum += taps[k];
+            }
+            for (int k = 0; k < sinc_taps; ++k)
+            {
+                table[phase * sinc_taps + k] = static_cast<float>(taps[k] / sum);
+            }
+        }
+    }
+
+    static inline ResampleQuality global_quality{ResampleQuality::Linear};
+};
@@ -0,0 +1,295 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cstddef>
+#include <format>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "job-system.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define BLEND_KERNEL_X86 1
+#if defined(__GNUC__) || defined(__clang__)
+#define BLEND_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define BLEND_TARGET_AVX2
+#endif
+#endif
+
+/*
+Premultiplied-alpha "source over" on 32-bit ARGB8888 pixels:
+
+    dst = src + dst * (255 - src.a) / 255
+
+per channel, alpha included. The division is the usual exact-for-bytes
+(x + 128 + ((x + 128) >> 8)) >> 8, so every kernel produces the same bytes.
+SIMD kernels widen to 16 bits, 4 (SSE2) or 8 (AVX2) pixels per step; the
+widest one the CPU supports is picked at runtime.
+*/
+enum class BlendKernel
+{
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+inline const char *to_string(BlendKernel kernel)
+{
+    switch (kernel)
+    {
+    case BlendKernel::Scalar:
+        return "scalar";
+    case BlendKernel::SSE2:
+        return "sse2";
+    case BlendKernel::AVX2:
+        return "avx2";
+    }
+    return "unknown";
+}
+
+inline bool blend_kernel_available(BlendKernel kernel)
+{
+    switch (kernel)
+    {
+    case BlendKernel::Scalar:
+        return true;
+#ifdef BLEND_KERNEL_X86
+    case BlendKernel::SSE2:
+        return SDL_HasSSE2();
+    case BlendKernel::AVX2:
+        return SDL_HasAVX2();
+#else
+    default:
+        return false;
+#endif
+    }
+    return false;
+}
+
+inline BlendKernel best_blend_kernel()
+{
+    static const BlendKernel best = blend_kernel_available(BlendKernel::AVX2)   ? BlendKernel::AVX2
+                                    : blend_kernel_available(BlendKernel::SSE2) ? BlendKernel::SSE2
+                                                                                : BlendKernel::Scalar;
+    return best;
+}
+
+inline void blend_span(Uint32 *dst, const Uint32 *src, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        Uint32 s = src[i];
+        Uint32 inv = 255 - (s >> 24);
+        Uint32 out = 0;
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            Uint32 x = ((dst[i] >> shift) & 0xff) * inv + 128;
+            Uint32 channel = ((s >> shift) & 0xff) + ((x + (x >> 8)) >> 8);
+            out |= std::min<Uint32>(channel, 255) << shift;
+        }
+        dst[i] = out;
+    }
+}
+
+#ifdef BLEND_KERNEL_X86
+// Two pixels widened to 16 bits per channel: dst * (255 - src.a) / 255.
+inline __m128i scale_by_inverse_alpha_sse2(__m128i s16, __m128i d16)
+{
+    __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s16, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    __m128i x = _mm_add_epi16(_mm_mullo_epi16(d16, _mm_sub_epi16(_mm_set1_epi16(255), a)), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+inline void blend_span_sse2(Uint32 *dst, const Uint32 *src, int count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+        __m128i lo = scale_by_inverse_alpha_sse2(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+        __m128i hi = scale_by_inverse_alpha_sse2(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_adds_epu8(s, _mm_packus_epi16(lo, hi)));
+    }
+    blend_span(dst + i, src + i, count - i);
+}
+
+BLEND_TARGET_AVX2 inline __m256i scale_by_inverse_alpha_avx2(__m256i s16, __m256i d16)
+{
+    __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s16, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    __m256i x = _mm256_add_epi16(_mm256_mullo_epi16(d16, _mm256_sub_epi16(_mm256_set1_epi16(255), a)),
+                                 _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+// Unpack and pack both work within 128-bit lanes, so pixels come back in order.
+BLEND_TARGET_AVX2 inline void blend_span_avx2(Uint32 *dst, const Uint32 *src, int count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+        __m256i lo = scale_by_inverse_alpha_avx2(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero));
+        __m256i hi = scale_by_inverse_alpha_avx2(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_adds_epu8(s, _mm256_packus_epi16(lo, hi)));
+    }
+    blend_span(dst + i, src + i, count - i);
+}
+#endif
+
+inline void blend_span(Uint32 *dst, const Uint32 *src, int count, BlendKernel kernel)
+{
+    switch (kernel)
+    {
+#ifdef BLEND_KERNEL_X86
+    case BlendKernel::AVX2:
+        blend_span_avx2(dst, src, count);
+        return;
+    case BlendKernel::SSE2:
+        blend_span_sse2(dst, src, count);
+        return;
+#endif
+    default:
+        blend_span(dst, src, count);
+    }
+}
+
+using SurfacePtr = std::unique_ptr<SDL_Surface, decltype(&SDL_FreeSurface)>;
+
+// An ARGB8888 copy of `surface` with colours multiplied by alpha, ready for SoftCompositor.
+inline SurfacePtr premultiplied_copy(SDL_Surface *surface)
+{
+    SurfacePtr copy{SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0), SDL_FreeSurface};
+    if (!copy || SDL_PremultiplyAlpha(copy->w, copy->h, SDL_PIXELFORMAT_ARGB8888, copy->pixels, copy->pitch,
+                                      SDL_PIXELFORMAT_ARGB8888, copy->pixels, copy->pitch))
+    {
+        auto error = std::format("Error premultiplying Surface: {}", SDL_GetError());
+        throw std::runtime_error(error);
+    }
+    return copy;
+}
+
+/*
+Software compositor for unscaled sprite batches.
+
+Sprites are queued with add() and drawn by flush() in submission order. The
+target is cut into square tiles and every sprite is binned into the tiles it
+covers, so each tile is blended start to finish while it sits in cache.
+Each row of tiles is one job: rows are disjoint bands of the framebuffer,
+so threads never share a destination pixel.
+*/
+class SoftCompositor
+{
+public:
+    struct Stats
+    {
+        std::size_t sprites;
+        std::size_t pixels;
+        std::size_t tiles_touched;
+    };
+
+    explicit SoftCompositor(JobSystem &jobs, int tile_size = 64) : jobs{jobs}, tile_size{tile_size} {}
+
+    // `sprite` must be premultiplied ARGB8888 and stay alive until flush().
+    void add(const SDL_Surface *sprite, int x, int y) { this->sprites.push_back({sprite, x, y}); }
+
+    // Blends every queued sprite over `pixels` (ARGB8888, `pitch` in bytes) and clears the queue.
+    void flush(void *pixels, int pitch, int width, int height, BlendKernel kernel = best_blend_kernel())
+    {
+        int columns = (width + this->tile_size - 1) / this->tile_size;
+        int rows = (height + this->tile_size - 1) / this->tile_size;
+        this->bins.resize(static_cast<std::size_t>(columns * rows));
+        for (auto &bin : this->bins)
+        {
+            bin.clear();
+        }
+
+        this->last = Stats{this->sprites.size(), 0, 0};
+        for (std::size_t i = 0; i < this->sprites.size(); ++i)
+        {
+            const Sprite &sprite = this->sprites[i];
+            int left = std::max(sprite.x, 0), right = std::min(sprite.x + sprite.surface->w, width);
+            int top = std::max(sprite.y, 0), bottom = std::min(sprite.y + sprite.surface->h, height);
+            if (left >= right || top >= bottom)
+            {
+                continue;
+            }
+            this->last.pixels += static_cast<std::size_t>((right - left) * (bottom - top));
+            for (int row = top / this->tile_size; row <= (bottom - 1) / this->tile_size; ++row)
+            {
+                for (int column = left / this->tile_size; column <= (right - 1) / this->tile_size; ++column)
+                {
+                    this->bins[row * columns + column].push_back(static_cast<Uint32>(i));
+                }
+            }
+        }
+        for (const auto &bin : this->bins)
+        {
+            this->last.tiles_touched += !bin.empty();
+        }
+
+        auto *target = static_cast<Uint8 *>(pixels);
+        this->jobs.parallel_for(0, static_cast<std::size_t>(rows), 1,
+                                [&](std::size_t begin, std::size_t end)
+                                {
+                                    for (std::size_t row = begin; row < end; ++row)
+                                    {
+                                        this->blend_band(target, pitch, width, height, static_cast<int>(row),
+                                                         columns, kernel);
+                                    }
+                                });
+        this->sprites.clear();
+    }
+
+    const Stats &stats() const { return this->last; }
+
+private:
+    struct Sprite
+    {
+        const SDL_Surface *surface;
+        int x;
+        int y;
+    };
+
+    void blend_band(Uint8 *target, int pitch, int width, int height, int row, int columns, BlendKernel kernel)
+    {
+        int tile_top = row * this->tile_size;
+        int tile_bottom = std::min(tile_top + this->tile_size, height);
+        for (int column = 0; column < columns; ++column)
+        {
+            int tile_left = column * this->tile_size;
+            int tile_right = std::min(tile_left + this->tile_size, width);
+            for (Uint32 i : this->bins[row * columns + column])
+            {
+                const Sprite &sprite = this->sprites[i];
+                const SDL_Surface *surface = sprite.surface;
+                int left = std::max(sprite.x, tile_left);
+                int right = std::min(sprite.x + surface->w, tile_right);
+                int top = std::max(sprite.y, tile_top);
+                int bottom = std::min(sprite.y + surface->h, tile_bottom);
+                for (int y = top; y < bottom; ++y)
+                {
+                    auto *dst = reinterpret_cast<Uint32 *>(target + static_cast<std::size_t>(y) * pitch) + left;
+                    auto *src = reinterpret_cast<const Uint32 *>(static_cast<const Uint8 *>(surface->pixels) +
+                                                                 static_cast<std::size_t>(y - sprite.y) *
+                                                                     surface->pitch) +
+                                (left - sprite.x);
+                    blend_span(dst, src, right - left, kernel);
+                }
+            }
+        }
+    }
+
+    JobSystem &jobs;
+    int tile_size;
+    std::vector<Sprite> sprites;
+    std::vector<std::vector<Uint32>> bins;
+    Stats last{};
+};
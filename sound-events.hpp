@@ -0,0 +1,157 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <algorithm>
+#include <vector>
+
+#include "audio-queue.hpp"
+
+/*
+Collects sound triggers during a frame and turns them into one batch of
+audio commands.
+
+- triggers of the same sound inside the window are merged into one voice at
+  the loudest trigger's volume
+- a sound that played less than min_interval frames ago is throttled
+- the survivors are ranked by loudness * priority and at most max_voices
+  are submitted
+*/
+class SoundEventCoalescer
+{
+public:
+    struct FrameStats
+    {
+        int triggers;
+        int merged;
+        int throttled;
+        int culled;
+        int submitted;
+    };
+
+    struct Totals
+    {
+        Uint64 frames;
+        Uint64 triggers;
+        Uint64 merged;
+        Uint64 throttled;
+        Uint64 culled;
+        Uint64 submitted;
+        int max_merged;
+    };
+
+    explicit SoundEventCoalescer(int max_voices = 8, Uint32 window_frames = 1)
+        : max_voices{max_voices}, window_frames{window_frames}
+    {
+        this->batch.reserve(static_cast<std::size_t>(max_voices));
+    }
+
+    int add_sound(Mix_Chunk *chunk, Uint32 min_interval, float priority = 1.0f)
+    {
+        this->sounds.push_back({chunk, min_interval, priority, 0.0f, 0, 0, false});
+        this->ranked.reserve(this->sounds.size());
+        return static_cast<int>(this->sounds.size() - 1);
+    }
+
+    // `count` identical triggers at once, e.g. every bounce from one batch update.
+    void trigger(int sound, float loudness = 1.0f, int count = 1)
+    {
+        Sound &s = this->sounds[static_cast<std::size_t>(sound)];
+        s.loudness = std::max(s.loudness, std::clamp(loudness, 0.0f, 1.0f));
+        s.pending += count;
+        this->current.triggers += count;
+    }
+
+    // Call once per frame; only submits when the window has elapsed.
+    void flush(Uint64 frame, AudioCommandQueue &queue)
+    {
+        if (frame - this->window_start + 1 < this->window_frames)
+        {
+            return;
+        }
+        this->window_start = frame + 1;
+
+        this->ranked.clear();
+        for (Sound &s : this->sounds)
+        {
+            if (!s.pending)
+            {
+                continue;
+            }
+            this->current.merged += s.pending - 1;
+            if (s.played && frame - s.last_frame < s.min_interval)
+            {
+                ++this->current.throttled;
+            }
+            else
+            {
+                this->ranked.push_back(&s);
+            }
+            s.pending = 0;
+        }
+
+        std::sort(this->ranked.begin(), this->ranked.end(),
+                  [](const Sound *a, const Sound *b)
+                  { return a->loudness * a->priority > b->loudness * b->priority; });
+
+        this->batch.clear();
+        for (Sound *s : this->ranked)
+        {
+            if (static_cast<int>(this->batch.size()) == this->max_voices)
+            {
+                ++this->current.culled;
+            }
+            else
+            {
+                int volume = static_cast<int>(s->loudness * MIX_MAX_VOLUME + 0.5f);
+                this->batch.push_back(AudioCommand::play_at_volume(s->chunk, volume));
+                s->last_frame = frame;
+                s->played = true;
+            }
+        }
+        for (Sound &s : this->sounds)
+        {
+            s.loudness = 0.0f;
+        }
+
+        if (!this->batch.empty() && queue.push_batch(this->batch.data(), this->batch.size()))
+        {
+            this->current.submitted = static_cast<int>(this->batch.size());
+        }
+
+        this->last = this->current;
+        ++this->totals.frames;
+        this->totals.triggers += this->current.triggers;
+        this->totals.merged += this->current.merged;
+        this->totals.throttled += this->current.throttled;
+        this->totals.culled += this->current.culled;
+        this->totals.submitted += this->current.submitted;
+        this->totals.max_merged = std::max(this->totals.max_merged, this->current.merged);
+        this->current = {};
+    }
+
+    const FrameStats &last_frame() const { return this->last; }
+    const Totals &total() const { return this->totals; }
+
+private:
+    struct Sound
+    {
+        Mix_Chunk *chunk;
+        Uint32 min_interval;
+        float priority;
+        float loudness;
+        int pending;
+        Uint64 last_frame;
+        bool played;
+    };
+
+    std::vector<Sound> sounds;
+    std::vector<Sound *> ranked;
+    std::vector<AudioCommand> batch;
+    int max_voices;
+    Uint32 window_frames;
+    Uint64 window_start{0};
+    FrameStats current{};
+    FrameStats last{};
+    Totals totals{};
+};
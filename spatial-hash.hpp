@@ -0,0 +1,226 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "entity-store.hpp"
+
+/*
+Broad phase: a uniform grid hashed into a flat bucket array, rebuilt from
+scratch every frame.
+
+build() inserts every box into each cell it overlaps and counting-sorts the
+entries by bucket, so a frame costs two linear passes and no allocation once
+the vectors have grown. Entries carry a copy of their box, so pair tests and
+queries never chase ids back into the entity arrays. A pair that shares
+several cells is reported only from the cell holding the top-left corner of
+their overlap.
+
+Ids are the dense indices of the arrays passed to build(), as of that build.
+*/
+class SpatialHash
+{
+public:
+    struct Stats
+    {
+        std::size_t boxes;
+        std::size_t entries;
+        std::size_t buckets;
+        std::size_t pairs;
+        double build_ms;
+    };
+
+    explicit SpatialHash(float cell_size = 64.0f) : inv_cell{1.0f / cell_size} {}
+
+    // Takes effect at the next build().
+    void set_cell_size(float size) { this->inv_cell = 1.0f / size; }
+
+    void build(const EntityStore &entities)
+    {
+        this->build(entities.x(), entities.y(), entities.w(), entities.h(), entities.size());
+    }
+
+    void build(const float *x, const float *y, const float *w, const float *h, std::size_t count)
+    {
+        Uint64 start = SDL_GetPerformanceCounter();
+
+        this->unsorted.clear();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            int x0 = this->cell(x[i]), x1 = this->cell(x[i] + w[i]);
+            int y0 = this->cell(y[i]), y1 = this->cell(y[i] + h[i]);
+            for (int cy = y0; cy <= y1; ++cy)
+            {
+                for (int cx = x0; cx <= x1; ++cx)
+                {
+                    this->unsorted.push_back({cx, cy, static_cast<Uint32>(i), x[i], y[i], x[i] + w[i], y[i] + h[i]});
+                }
+            }
+        }
+
+        std::size_t buckets = 16;
+        while (buckets < this->unsorted.size())
+        {
+            buckets <<= 1;
+        }
+        this->mask = buckets - 1;
+
+        this->starts.assign(buckets + 1, 0);
+        for (const Entry &entry : this->unsorted)
+        {
+            ++this->starts[this->bucket(entry.cx, entry.cy) + 1];
+        }
+        for (std::size_t b = 0; b < buckets; ++b)
+        {
+            this->starts[b + 1] += this->starts[b];
+        }
+        this->cursor.assign(this->starts.begin(), this->starts.end() - 1);
+        this->entries.resize(this->unsorted.size());
+        for (const Entry &entry : this->unsorted)
+        {
+            this->entries[this->cursor[this->bucket(entry.cx, entry.cy)]++] = entry;
+        }
+
+        if (this->stamps.size() < count)
+        {
+            this->stamps.resize(count, 0);
+        }
+
+        this->last.boxes = count;
+        this->last.entries = this->entries.size();
+        this->last.buckets = buckets;
+        this->last.pairs = 0;
+        this->last.build_ms = static_cast<double>(SDL_GetPerformanceCounter() - start) * 1e3 /
+                              static_cast<double>(SDL_GetPerformanceFrequency());
+    }
+
+    // fn(a, b) once for every pair of overlapping boxes, a < b.
+    template <typename Fn>
+    std::size_t for_each_pair(Fn &&fn)
+    {
+        std::size_t pairs = 0;
+        std::size_t buckets = this->starts.size() - 1;
+        for (std::size_t b = 0; b < buckets; ++b)
+        {
+            for (Uint32 i = this->starts[b]; i < this->starts[b + 1]; ++i)
+            {
+                const Entry &p = this->entries[i];
+                for (Uint32 j = i + 1; j < this->starts[b + 1]; ++j)
+                {
+                    const Entry &q = this->entries[j];
+                    if (p.cx != q.cx || p.cy != q.cy || !overlaps(p, q))
+                    {
+                        continue;
+                    }
+                    float ox = std::max(p.left, q.left);
+                    float oy = std::max(p.top, q.top);
+                    if (this->cell(ox) == p.cx && this->cell(oy) == p.cy)
+                    {
+                        fn(std::min(p.id, q.id), std::max(p.id, q.id));
+                        ++pairs;
+                    }
+                }
+            }
+        }
+        this->last.pairs = pairs;
+        return pairs;
+    }
+
+    // Appends the ids of boxes overlapping the query box, each once.
+    void query_aabb(float x, float y, float w, float h, std::vector<Uint32> &out) const
+    {
+        Uint32 stamp = this->next_stamp();
+        int x0 = this->cell(x), x1 = this->cell(x + w);
+        int y0 = this->cell(y), y1 = this->cell(y + h);
+        for (int cy = y0; cy <= y1; ++cy)
+        {
+            for (int cx = x0; cx <= x1; ++cx)
+            {
+                std::size_t b = this->bucket(cx, cy);
+                for (Uint32 i = this->starts[b]; i < this->starts[b + 1]; ++i)
+                {
+                    const Entry &e = this->entries[i];
+                    if (e.cx != cx || e.cy != cy || this->stamps[e.id] == stamp)
+                    {
+                        continue;
+                    }
+                    this->stamps[e.id] = stamp;
+                    if (x < e.right && e.left < x + w && y < e.bottom && e.top < y + h)
+                    {
+                        out.push_back(e.id);
+                    }
+                }
+            }
+        }
+    }
+
+    void query_point(float px, float py, std::vector<Uint32> &out) const
+    {
+        int cx = this->cell(px);
+        int cy = this->cell(py);
+        std::size_t b = this->bucket(cx, cy);
+        for (Uint32 i = this->starts[b]; i < this->starts[b + 1]; ++i)
+        {
+            const Entry &e = this->entries[i];
+            if (e.cx == cx && e.cy == cy && px >= e.left && px < e.right && py >= e.top && py < e.bottom)
+            {
+                out.push_back(e.id);
+            }
+        }
+    }
+
+    const Stats &stats() const { return this->last; }
+
+private:
+    struct Entry
+    {
+        int cx;
+        int cy;
+        Uint32 id;
+        float left;
+        float top;
+        float right;
+        float bottom;
+    };
+
+    // floor() without the libm call baseline x86-64 makes for std::floor.
+    int cell(float v) const
+    {
+        float scaled = v * this->inv_cell;
+        int truncated = static_cast<int>(scaled);
+        return truncated - (scaled < static_cast<float>(truncated));
+    }
+
+    std::size_t bucket(int cx, int cy) const
+    {
+        Uint32 hash = static_cast<Uint32>(cx) * 73856093u ^ static_cast<Uint32>(cy) * 19349663u;
+        return hash & this->mask;
+    }
+
+    static bool overlaps(const Entry &a, const Entry &b)
+    {
+        return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+    }
+
+    Uint32 next_stamp() const
+    {
+        if (++this->stamp == 0)
+        {
+            std::fill(this->stamps.begin(), this->stamps.end(), 0);
+            this->stamp = 1;
+        }
+        return this->stamp;
+    }
+
+    float inv_cell;
+    std::size_t mask{0};
+    std::vector<Entry> unsorted;
+    std::vector<Entry> entries;
+    std::vector<Uint32> starts{0, 0};
+    std::vector<Uint32> cursor;
+    mutable std::vector<Uint32> stamps;
+    mutable Uint32 stamp{0};
+    Stats last{};
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <cstddef>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+/*
+A texture whose pixels change every frame, without creating textures.
+
+Pixels are drawn into a CPU copy (ARGB8888) and the regions touched are
+marked dirty. present() locks only what the next texture is missing, copies
+those rows in and returns it for drawing. The SDL_TEXTUREACCESS_STREAMING
+textures are created once and used round-robin, so the one just drawn from
+is not locked again until the others have had their turn; each keeps its
+own dirty rectangle, so a region changed once reaches every buffer.
+
+Locked texture memory is write-only, which is why the CPU copy exists:
+partial uploads need the rest of the region from somewhere.
+*/
+class StreamingTexture
+{
+public:
+    struct Stats
+    {
+        std::size_t uploads;
+        std::size_t bytes_uploaded;
+        std::size_t textures_created;
+    };
+
+    StreamingTexture(SDL_Renderer *renderer, int width, int height, int buffers = 2)
+        : width{width}, height{height}, cpu(static_cast<std::size_t>(width) * height)
+    {
+        for (int i = 0; i < buffers; ++i)
+        {
+            SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                                     width, height);
+            if (!texture)
+            {
+                auto error = std::format("Error creating streaming Texture: {}", SDL_GetError());
+                throw std::runtime_error(error);
+            }
+            this->buffers.push_back({{texture, SDL_DestroyTexture}, {0, 0, width, height}});
+            ++this->counters.textures_created;
+        }
+    }
+
+    int w() const { return this->width; }
+    int h() const { return this->height; }
+
+    // The CPU copy, `pitch()` pixels per row. Call mark_dirty() for whatever is changed.
+    Uint32 *pixels() { return this->cpu.data(); }
+    int pitch() const { return this->width; }
+
+    void mark_dirty(const SDL_Rect &region)
+    {
+        SDL_Rect bounds{0, 0, this->width, this->height};
+        SDL_Rect clipped;
+        if (!SDL_IntersectRect(&region, &bounds, &clipped))
+        {
+            return;
+        }
+        for (Buffer &buffer : this->buffers)
+        {
+            if (SDL_RectEmpty(&buffer.missing))
+            {
+                buffer.missing = clipped;
+            }
+            else
+            {
+                SDL_UnionRect(&buffer.missing, &clipped, &buffer.missing);
+            }
+        }
+    }
+
+    // After SDL_RENDER_TARGETS_RESET or SDL_RENDER_DEVICE_RESET: every buffer gets a full upload.
+    void invalidate() { this->mark_dirty({0, 0, this->width, this->height}); }
+
+    void set_blend_mode(SDL_BlendMode blend)
+    {
+        for (Buffer &buffer : this->buffers)
+        {
+            SDL_SetTextureBlendMode(buffer.texture.get(), blend);
+        }
+    }
+
+    // Brings the next buffer up to date and returns it; draw it this frame.
+    SDL_Texture *present()
+    {
+        this->current = (this->current + 1) % this->buffers.size();
+        Buffer &buffer = this->buffers[this->current];
+        if (SDL_RectEmpty(&buffer.missing))
+        {
+            return buffer.texture.get();
+        }
+
+        void *locked = nullptr;
+        int locked_pitch = 0;
+        if (SDL_LockTexture(buffer.texture.get(), &buffer.missing, &locked, &locked_pitch))
+        {
+            auto error = std::format("Error locking Texture: {}", SDL_GetError());
+            throw std::runtime_error(error);
+        }
+        const SDL_Rect &r = buffer.missing;
+        std::size_t row_bytes = static_cast<std::size_t>(r.w) * sizeof(Uint32);
+        for (int y = 0; y < r.h; ++y)
+        {
+            std::memcpy(static_cast<Uint8 *>(locked) + static_cast<std::size_t>(y) * locked_pitch,
+                        this->cpu.data() + static_cast<std::size_t>(r.y + y) * this->width + r.x, row_bytes);
+        }
+        SDL_UnlockTexture(buffer.texture.get());
+
+        ++this->counters.uploads;
+        this->counters.bytes_uploaded += row_bytes * r.h;
+        buffer.missing = {0, 0, 0, 0};
+        return buffer.texture.get();
+    }
+
+    // The buffer returned by the last present().
+    SDL_Texture *texture() const { return this->buffers[this->current].texture.get(); }
+
+    const Stats &stats() const { return this->counters; }
+
+private:
+    struct Buffer
+    {
+        std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)> texture;
+        SDL_Rect missing;
+    };
+
+    int width;
+    int height;
+    std::vector<Uint32> cpu;
+    std::vector<Buffer> buffers;
+    std::size_t current{0};
+    Stats counters{};
+};
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <cstddef>
+#include <format>
+#include <functional>
+#include <list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/*
+Rendered text textures, keyed by (font, size, colour, string).
+
+A hit is a hash lookup and a splice to the front of the LRU list; only a
+string not seen recently pays TTF_RenderText_Blended and
+SDL_CreateTextureFromSurface. Textures are charged w * h * 4 bytes against
+the budget and the least recently used go first, except those used since the
+last end_frame(): they may still be queued for drawing, so the cache runs
+over budget for a frame rather than free them.
+*/
+class TextCache
+{
+public:
+    struct Entry
+    {
+        SDL_Texture *texture;
+        int w;
+        int h;
+    };
+
+    struct Stats
+    {
+        std::size_t hits;
+        std::size_t misses;
+        std::size_t evictions;
+        std::size_t entries;
+        std::size_t bytes;
+    };
+
+    // Called with every texture just before it is destroyed, e.g. RenderCommandBuffer::forget.
+    using EvictFn = std::function<void(SDL_Texture *)>;
+
+    TextCache(SDL_Renderer *renderer, std::size_t budget_bytes, EvictFn on_evict = {})
+        : renderer{renderer}, budget{budget_bytes}, on_evict{std::move(on_evict)} {}
+
+    TextCache(const TextCache &) = delete;
+    TextCache &operator=(const TextCache &) = delete;
+    ~TextCache() { this->clear(); }
+
+    // `size` is the point size `font` was opened at; two fonts at one size are still told apart by pointer.
+    Entry get(TTF_Font *font, int size, SDL_Color color, std::string_view text)
+    {
+        KeyView key{font, size, pack(color), text};
+        auto found = this->index.find(key);
+        if (found != this->index.end())
+        {
+            ++this->counters.hits;
+            this->lru.splice(this->lru.begin(), this->lru, found->second);
+            found->second->used_frame = this->frame;
+            return found->second->entry;
+        }
+
+        ++this->counters.misses;
+        std::string owned{text};
+        std::unique_ptr<SDL_Surface, decltype(&SDL_FreeSurface)> surface{
+            TTF_RenderText_Blended(font, owned.empty() ? " " : owned.c_str(), color), SDL_FreeSurface};
+        if (!surface)
+        {
+            auto error = std::format("Error rendering text Surface: {}", TTF_GetError());
+            throw std::runtime_error(error);
+        }
+        SDL_Texture *texture = SDL_CreateTextureFromSurface(this->renderer, surface.get());
+        if (!texture)
+        {
+            auto error = std::format("Error creating Texture from Surface: {}", SDL_GetError());
+            throw std::runtime_error(error);
+        }
+
+        std::size_t bytes = static_cast<std::size_t>(surface->w) * surface->h * 4;
+        this->lru.push_front({Key{font, size, key.color, std::move(owned)}, {texture, surface->w, surface->h}, bytes,
+                              this->frame});
+        const Key &stored = this->lru.front().key;
+        this->index.emplace(KeyView{stored.font, stored.size, stored.color, stored.text}, this->lru.begin());
+        this->counters.bytes += bytes;
+        this->evict();
+        return this->lru.front().entry;
+    }
+
+    // Entries used before this call become evictable.
+    void end_frame() { ++this->frame; }
+
+    void clear()
+    {
+        while (!this->lru.empty())
+        {
+            this->drop_back();
+        }
+    }
+
+    Stats stats() const
+    {
+        Stats stats = this->counters;
+        stats.entries = this->lru.size();
+        return stats;
+    }
+
+    double hit_rate() const
+    {
+        std::size_t lookups = this->counters.hits + this->counters.misses;
+        return lookups ? static_cast<double>(this->counters.hits) / lookups : 0.0;
+    }
+
+private:
+    struct Key
+    {
+        TTF_Font *font;
+        int size;
+        Uint32 color;
+        std::string text;
+    };
+
+    // Points into a Key, or at the caller's string for lookups, so a hit allocates nothing.
+    struct KeyView
+    {
+        TTF_Font *font;
+        int size;
+        Uint32 color;
+        std::string_view text;
+
+        bool operator==(const KeyView &) const = default;
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()(const KeyView &key) const
+        {
+            std::size_t hash = std::hash<std::string_view>{}(key.text);
+            hash ^= std::hash<const void *>{}(key.font) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+            hash ^= (static_cast<std::size_t>(key.color) << 8 ^ static_cast<std::size_t>(key.size)) + (hash << 6);
+            return hash;
+        }
+    };
+
+    struct Node
+    {
+        Key key;
+        Entry entry;
+        std::size_t bytes;
+        Uint64 used_frame;
+    };
+
+    static Uint32 pack(SDL_Color color)
+    {
+        return Uint32{color.r} << 24 | Uint32{color.g} << 16 | Uint32{color.b} << 8 | color.a;
+    }
+
+    void evict()
+    {
+        while (this->counters.bytes > this->budget && !this->lru.empty() && this->lru.back().used_frame != this->frame)
+        {
+            this->drop_back();
+            ++this->counters.evictions;
+        }
+    }
+
+    void drop_back()
+    {
+        Node &node = this->lru.back();
+        if (this->on_evict)
+        {
+            this->on_evict(node.entry.texture);
+        }
+        SDL_DestroyTexture(node.entry.texture);
+        this->counters.bytes -= node.bytes;
+        this->index.erase(KeyView{node.key.font, node.key.size, node.key.color, node.key.text});
+        this->lru.pop_back();
+    }
+
+    SDL_Renderer *renderer;
+    std::size_t budget;
+    EvictFn on_evict;
+    std::list<Node> lru;
+    std::unordered_map<KeyView, std::list<Node>::iterator, KeyHash> index;
+    Uint64 frame{0};
+    Stats counters{};
+};
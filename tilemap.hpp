@@ -0,0 +1,432 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "camera.hpp"
+
+/*
+Tile grid: width * height tile ids, row-major, 0 = empty. Ids index the
+tileset left to right starting at 1.
+
+tilemap file (little-endian)
+  TilemapHeader (16 bytes)
+  width * height Uint16 tile ids
+*/
+class Tilemap
+{
+public:
+    // Chunk textures are 32 tiles across; this keeps them within what every renderer can allocate.
+    static constexpr int max_tile_size = 256;
+
+    Tilemap() = default;
+    Tilemap(int width, int height, int tile_size)
+        : map_width{width}, map_height{height}, size{tile_size},
+          tiles(static_cast<std::size_t>(width) * static_cast<std::size_t>(height), 0) {}
+
+    int width() const { return this->map_width; }
+    int height() const { return this->map_height; }
+    int tile_size() const { return this->size; }
+
+    Uint16 at(int x, int y) const { return this->tiles[this->offset(x, y)]; }
+
+    // Recorded so the renderer redraws the chunk holding (x, y).
+    void set(int x, int y, Uint16 tile)
+    {
+        this->tiles[this->offset(x, y)] = tile;
+        this->edits.push_back({x, y});
+    }
+
+    // Tiles written since the last call.
+    std::vector<SDL_Point> take_edits()
+    {
+        std::vector<SDL_Point> taken;
+        taken.swap(this->edits);
+        return taken;
+    }
+
+    // Rolling terrain from a coarse lattice of random heights, banded into `tile_kinds` ids.
+    static Tilemap generate(int width, int height, int tile_size, int tile_kinds, Uint32 seed)
+    {
+        Tilemap map{width, height, tile_size};
+        constexpr int cell = 32;
+        auto lattice = [seed](int x, int y)
+        {
+            Uint32 h = static_cast<Uint32>(x) * 374761393u + static_cast<Uint32>(y) * 668265263u + seed;
+            h = (h ^ (h >> 13)) * 1274126177u;
+            return static_cast<float>((h ^ (h >> 16)) & 0xffff) / 65535.0f;
+        };
+
+        for (int y = 0; y < height; ++y)
+        {
+            int cy = y / cell;
+            float fy = static_cast<float>(y % cell) / cell;
+            for (int x = 0; x < width; ++x)
+            {
+                int cx = x / cell;
+                float fx = static_cast<float>(x % cell) / cell;
+                float top = lattice(cx, cy) + (lattice(cx + 1, cy) - lattice(cx, cy)) * fx;
+                float bottom = lattice(cx, cy + 1) + (lattice(cx + 1, cy + 1) - lattice(cx, cy + 1)) * fx;
+                float h = top + (bottom - top) * fy;
+                int kind = std::min(static_cast<int>(h * tile_kinds), tile_kinds - 1);
+                map.tiles[map.offset(x, y)] = static_cast<Uint16>(kind + 1);
+            }
+        }
+        return map;
+    }
+
+    static Tilemap load(const std::string &path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        TilemapHeader header{};
+        in.read(reinterpret_cast<char *>(&header), sizeof(header));
+        if (!in || std::memcmp(header.magic, "TMP1", 4) || header.width <= 0 || header.height <= 0 ||
+            header.tile_size <= 0 || header.tile_size > max_tile_size)
+        {
+            auto error = std::format("Error reading tilemap: {}", path);
+            throw std::runtime_error(error);
+        }
+
+        // Checked before the tiles are allocated, so corrupt dimensions are a read error rather than
+        // std::bad_alloc. Dividing instead of multiplying keeps the check itself from overflowing.
+        std::streamoff tiles_at = in.tellg();
+        in.seekg(0, std::ios::end);
+        std::streamoff remaining = in.tellg() - tiles_at;
+        in.seekg(tiles_at);
+        if (!in || static_cast<std::size_t>(header.height) >
+                       static_cast<std::size_t>(remaining) / sizeof(Uint16) / static_cast<std::size_t>(header.width))
+        {
+            auto error = std::format("Error reading tilemap: {} is truncated", path);
+            throw std::runtime_error(error);
+        }
+
+        Tilemap map{header.width, header.height, header.tile_size};
+        in.read(reinterpret_cast<char *>(map.tiles.data()),
+                static_cast<std::streamsize>(map.tiles.size() * sizeof(Uint16)));
+        if (!in)
+        {
+            auto error = std::format("Error reading tilemap: {} is truncated", path);
+            throw std::runtime_error(error);
+        }
+        return map;
+    }
+
+    void save(const std::string &path) const
+    {
+        TilemapHeader header{};
+        std::memcpy(header.magic, "TMP1", 4);
+        header.width = this->map_width;
+        header.height = this->map_height;
+        header.tile_size = this->size;
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(this->tiles.data()),
+                  static_cast<std::streamsize>(this->tiles.size() * sizeof(Uint16)));
+        if (!out)
+        {
+            auto error = std::format("Error writing tilemap: {}", path);
+            throw std::runtime_error(error);
+        }
+    }
+
+private:
+    struct TilemapHeader
+    {
+        char magic[4];
+        int width;
+        int height;
+        int tile_size;
+    };
+    static_assert(sizeof(TilemapHeader) == 16);
+
+    std::size_t offset(int x, int y) const
+    {
+        return static_cast<std::size_t>(y) * static_cast<std::size_t>(this->map_width) + static_cast<std::size_t>(x);
+    }
+
+    int map_width{0};
+    int map_height{0};
+    int size{16};
+    std::vector<Uint16> tiles;
+    std::vector<SDL_Point> edits;
+};
+
+// Flat-coloured tiles with a darker rim, for maps that have no art yet.
+inline SDL_Texture *create_debug_tileset(SDL_Renderer *renderer, int tile_size, int kinds)
+{
+    SDL_Texture *tileset = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+                                             tile_size * kinds, tile_size);
+    if (!tileset)
+    {
+        auto error = std::format("Error creating tileset Texture: {}", SDL_GetError());
+        throw std::runtime_error(error);
+    }
+
+    static const SDL_Color palette[] = {
+        {30, 60, 160, 255}, {50, 90, 200, 255},  {220, 200, 120, 255}, {90, 170, 70, 255},
+        {60, 140, 50, 255}, {30, 100, 40, 255},  {120, 110, 100, 255}, {240, 240, 250, 255},
+    };
+    constexpr int palette_size = sizeof(palette) / sizeof(palette[0]);
+
+    SDL_Texture *previous = SDL_GetRenderTarget(renderer);
+    SDL_SetRenderTarget(renderer, tileset);
+    for (int kind = 0; kind < kinds; ++kind)
+    {
+        SDL_Color c = palette[kind % palette_size];
+        SDL_Rect tile{kind * tile_size, 0, tile_size, tile_size};
+        SDL_SetRenderDrawColor(renderer, c.r * 3 / 4, c.g * 3 / 4, c.b * 3 / 4, 255);
+        SDL_RenderFillRect(renderer, &tile);
+        SDL_Rect inner{tile.x + 1, tile.y + 1, tile_size - 2, tile_size - 2};
+        SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, 255);
+        SDL_RenderFillRect(renderer, &inner);
+    }
+    SDL_SetRenderTarget(renderer, previous);
+    return tileset;
+}
+
+/*
+Draws a Tilemap through chunk textures.
+
+The map is cut into chunk_tiles x chunk_tiles squares. The first time a chunk
+is on screen its tiles are rendered into its own SDL_TEXTUREACCESS_TARGET
+texture; after that a frame is one RenderCopy per visible chunk. Edited tiles
+mark their chunk dirty and only that chunk is redrawn.
+
+A 4096x4096 map is far too big to keep every chunk resident, so textures are
+recycled least-recently-drawn first once `max_chunks` exist; scrolling back to
+an evicted chunk renders it again.
+*/
+class TilemapRenderer
+{
+public:
+    struct Stats
+    {
+        int chunks_drawn;
+        int chunks_rendered;
+        int tiles_rendered;
+        int evictions;
+        std::size_t resident;
+    };
+
+    TilemapRenderer(Tilemap &map, SDL_Texture *tileset, int chunk_tiles = 32, std::size_t max_chunks = 64)
+        : map{map}, tileset{tileset}, chunk_tiles{chunk_tiles}, max_chunks{max_chunks},
+          chunks_x{(map.width() + chunk_tiles - 1) / chunk_tiles},
+          chunks_y{(map.height() + chunk_tiles - 1) / chunk_tiles},
+          slots(static_cast<std::size_t>(chunks_x) * static_cast<std::size_t>(chunks_y), no_texture) {}
+
+    // Render targets lose their contents on SDL_RENDER_TARGETS_RESET / SDL_RENDER_DEVICE_RESET.
+    void invalidate_all()
+    {
+        for (Chunk &chunk : this->resident)
+        {
+            chunk.dirty = true;
+        }
+    }
+
+    // Draws the part of the map under the view rectangle (map pixels) to dst on the current target.
+    void draw(SDL_Renderer *renderer, int view_x, int view_y, const SDL_Rect &dst)
+    {
+        this->begin_frame();
+        int chunk_px = this->chunk_tiles * this->map.tile_size();
+        int first_x = std::max(view_x, 0) / chunk_px;
+        int first_y = std::max(view_y, 0) / chunk_px;
+        int last_x = std::min((view_x + dst.w - 1) / chunk_px, this->chunks_x - 1);
+        int last_y = std::min((view_y + dst.h - 1) / chunk_px, this->chunks_y - 1);
+
+        for (int cy = first_y; cy <= last_y; ++cy)
+        {
+            for (int cx = first_x; cx <= last_x; ++cx)
+            {
+                SDL_Texture *texture = this->chunk_texture(renderer, cx, cy);
+                if (!texture)
+                {
+                    continue;
+                }
+                SDL_Rect to{dst.x + cx * chunk_px - view_x, dst.y + cy * chunk_px - view_y, chunk_px, chunk_px};
+                SDL_RenderCopy(renderer, texture, nullptr, &to);
+                ++this->last.chunks_drawn;
+            }
+        }
+        this->last.resident = this->resident.size();
+    }
+
+    // The map lies in world space from (0, 0); draws what `camera` sees, zoom included.
+    void draw(SDL_Renderer *renderer, const Camera &camera)
+    {
+        this->begin_frame();
+        int chunk_px = this->chunk_tiles * this->map.tile_size();
+        Aabb view = camera.view();
+        int first_x = std::max(static_cast<int>(std::floor(view.left / chunk_px)), 0);
+        int first_y = std::max(static_cast<int>(std::floor(view.top / chunk_px)), 0);
+        int last_x = std::min(static_cast<int>(std::floor(view.right / chunk_px)), this->chunks_x - 1);
+        int last_y = std::min(static_cast<int>(std::floor(view.bottom / chunk_px)), this->chunks_y - 1);
+
+        for (int cy = first_y; cy <= last_y; ++cy)
+        {
+            for (int cx = first_x; cx <= last_x; ++cx)
+            {
+                SDL_Texture *texture = this->chunk_texture(renderer, cx, cy);
+                if (!texture)
+                {
+                    continue;
+                }
+                // Neighbouring chunks share rounded edges, so zoomed views have no seams.
+                double left = static_cast<double>(cx) * chunk_px;
+                double top = static_cast<double>(cy) * chunk_px;
+                SDL_FPoint from = camera.to_screen(left, top);
+                SDL_FPoint to = camera.to_screen(left + chunk_px, top + chunk_px);
+                SDL_FRect rect{std::round(from.x), std::round(from.y), std::round(to.x) - std::round(from.x),
+                               std::round(to.y) - std::round(from.y)};
+                SDL_RenderCopyF(renderer, texture, nullptr, &rect);
+                ++this->last.chunks_drawn;
+            }
+        }
+        this->last.resident = this->resident.size();
+    }
+
+    const Stats &stats() const { return this->last; }
+
+private:
+    static constexpr int no_texture = -1;
+
+    struct Chunk
+    {
+        std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)> texture;
+        int index;
+        Uint64 last_drawn;
+        bool dirty;
+    };
+
+    void begin_frame()
+    {
+        this->last = Stats{0, 0, 0, 0, 0};
+        ++this->frame;
+
+        for (const SDL_Point &edit : this->map.take_edits())
+        {
+            int texture = this->slots[this->chunk_index(edit.x / this->chunk_tiles, edit.y / this->chunk_tiles)];
+            if (texture != no_texture)
+            {
+                this->resident[texture].dirty = true;
+            }
+        }
+    }
+
+    std::size_t chunk_index(int cx, int cy) const
+    {
+        return static_cast<std::size_t>(cy) * static_cast<std::size_t>(this->chunks_x) + static_cast<std::size_t>(cx);
+    }
+
+    SDL_Texture *chunk_texture(SDL_Renderer *renderer, int cx, int cy)
+    {
+        std::size_t index = this->chunk_index(cx, cy);
+        int slot = this->slots[index];
+        if (slot == no_texture)
+        {
+            slot = this->acquire(renderer, static_cast<int>(index));
+            if (slot == no_texture)
+            {
+                return nullptr;
+            }
+        }
+
+        Chunk &chunk = this->resident[slot];
+        chunk.last_drawn = this->frame;
+        if (chunk.dirty)
+        {
+            this->render_chunk(renderer, chunk.texture.get(), cx, cy);
+            chunk.dirty = false;
+        }
+        return chunk.texture.get();
+    }
+
+    // A fresh texture while under budget, otherwise the least recently drawn one.
+    int acquire(SDL_Renderer *renderer, int index)
+    {
+        int slot;
+        if (this->resident.size() < this->max_chunks)
+        {
+            int chunk_px = this->chunk_tiles * this->map.tile_size();
+            SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+                                                     chunk_px, chunk_px);
+            if (!texture)
+            {
+                return no_texture;
+            }
+            SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+            this->resident.push_back({{texture, SDL_DestroyTexture}, index, 0, true});
+            slot = static_cast<int>(this->resident.size() - 1);
+        }
+        else
+        {
+            auto oldest = std::min_element(this->resident.begin(), this->resident.end(),
+                                           [](const Chunk &a, const Chunk &b) { return a.last_drawn < b.last_drawn; });
+            if (oldest->last_drawn == this->frame)
+            {
+                return no_texture;
+            }
+            slot = static_cast<int>(oldest - this->resident.begin());
+            this->slots[oldest->index] = no_texture;
+            oldest->index = index;
+            oldest->dirty = true;
+            ++this->last.evictions;
+        }
+        this->slots[index] = slot;
+        return slot;
+    }
+
+    void render_chunk(SDL_Renderer *renderer, SDL_Texture *texture, int cx, int cy)
+    {
+        int size = this->map.tile_size();
+        SDL_Texture *previous = SDL_GetRenderTarget(renderer);
+        Uint8 r, g, b, a;
+        SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+        SDL_SetRenderTarget(renderer, texture);
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+        SDL_RenderClear(renderer);
+
+        int x0 = cx * this->chunk_tiles;
+        int y0 = cy * this->chunk_tiles;
+        int x1 = std::min(x0 + this->chunk_tiles, this->map.width());
+        int y1 = std::min(y0 + this->chunk_tiles, this->map.height());
+        for (int y = y0; y < y1; ++y)
+        {
+            for (int x = x0; x < x1; ++x)
+            {
+                Uint16 tile = this->map.at(x, y);
+                if (!tile)
+                {
+                    continue;
+                }
+                SDL_Rect src{(tile - 1) * size, 0, size, size};
+                SDL_Rect to{(x - x0) * size, (y - y0) * size, size, size};
+                SDL_RenderCopy(renderer, this->tileset, &src, &to);
+                ++this->last.tiles_rendered;
+            }
+        }
+
+        SDL_SetRenderTarget(renderer, previous);
+        SDL_SetRenderDrawColor(renderer, r, g, b, a);
+        ++this->last.chunks_rendered;
+    }
+
+    Tilemap &map;
+    SDL_Texture *tileset;
+    int chunk_tiles;
+    std::size_t max_chunks;
+    int chunks_x;
+    int chunks_y;
+    std::vector<int> slots;
+    std::vector<Chunk> resident;
+    Uint64 frame{0};
+    Stats last{};
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <atomic>
+#include <cstddef>
+
+/*
+Lock-free hand-off of whole values from one producer thread to one consumer.
+
+Three slots: the producer fills back(), publish() swaps it with the shared
+middle slot, and acquire() swaps the middle slot with the consumer's front
+slot if something new arrived. Neither side ever waits for the other; a
+value published before the consumer picked up the previous one replaces it
+and counts as dropped. Slots are reused, so T's buffers stop reallocating
+once they have grown.
+*/
+template <typename T>
+class TripleBuffer
+{
+public:
+    // Producer side.
+    T &back() { return this->slots[this->back_index]; }
+
+    void publish()
+    {
+        Uint8 previous = this->middle.exchange(static_cast<Uint8>(this->back_index | fresh), std::memory_order_acq_rel);
+        this->back_index = previous & index_mask;
+        ++this->published_count;
+        if (previous & fresh)
+        {
+            ++this->dropped_count;
+        }
+    }
+
+    // Consumer side: the newest value, or nullptr if nothing was published since the last call.
+    const T *acquire()
+    {
+        if (!(this->middle.load(std::memory_order_relaxed) & fresh))
+        {
+            return nullptr;
+        }
+        this->front_index = this->middle.exchange(this->front_index, std::memory_order_acq_rel) & index_mask;
+        return &this->slots[this->front_index];
+    }
+
+    // Read by the producer, or by anyone once the producer has stopped.
+    std::size_t published() const { return this->published_count; }
+    std::size_t dropped() const { return this->dropped_count; }
+
+private:
+    static constexpr Uint8 index_mask = 0x3;
+    static constexpr Uint8 fresh = 0x4;
+
+    T slots[3];
+    Uint8 back_index{0};
+    Uint8 front_index{1};
+    std::atomic<Uint8> middle{2};
+    std::size_t published_count{0};
+    std::size_t dropped_count{0};
+};